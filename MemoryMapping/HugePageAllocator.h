@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+
+#ifdef _MSC_VER
+	#include <malloc.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+namespace mm
+{
+	/// transparent huge pages size on x86-64 and most arm64 kernels
+	constexpr size_t hugePageBytes { size_t { 1 } << 21 };
+
+	/**
+	 * Allocator for large arrays (e.g. std::vector<T, HugePageAllocator<T>>) accessed at random:
+	 * allocations of at least hugePageBytes are 2MB aligned, rounded up to a multiple of 2MB and advised with MADV_HUGEPAGE,
+	 * so that the kernel backs them with transparent huge pages when first touched (if THP is enabled in "madvise" or "always" mode),
+	 * which cuts TLB misses by a factor 512. Smaller ones are left to std::allocator.
+	 * On Windows, where large pages need a privilege, allocations are only aligned
+	 */
+	template<typename T>
+	class HugePageAllocator
+	{
+	public:
+		using value_type = T;
+
+		HugePageAllocator() noexcept = default;
+
+		template<typename U>
+		// NOLINTNEXTLINE(google-explicit-constructor)
+		HugePageAllocator(const HugePageAllocator<U>&) noexcept
+		{
+		}
+
+		/// so that neither the size in bytes nor its rounding up to huge pages overflow
+		[[nodiscard]] size_t max_size() const noexcept { return (std::numeric_limits<size_t>::max() - hugePageBytes) / sizeof(T); }
+
+		[[nodiscard]] T* allocate(const size_t n)
+		{
+			if (n > max_size())
+				throw std::bad_array_new_length();
+
+			const size_t nBytes = n * sizeof(T);
+			if (nBytes < hugePageBytes)
+				return std::allocator<T>().allocate(n);
+
+			const size_t allocatedBytes = (nBytes + hugePageBytes - 1) / hugePageBytes * hugePageBytes;
+#ifdef _MSC_VER
+			void* ret = _aligned_malloc(allocatedBytes, hugePageBytes);
+#else
+			void* ret = nullptr;
+			if (posix_memalign(&ret, hugePageBytes, allocatedBytes) != 0)
+				ret = nullptr;
+			#ifdef MADV_HUGEPAGE
+			if (ret != nullptr)
+				::madvise(ret, allocatedBytes, MADV_HUGEPAGE);
+			#endif
+#endif
+			if (ret == nullptr)
+				throw std::bad_alloc();
+			return static_cast<T*>(ret);
+		}
+
+		void deallocate(T* p, const size_t n) noexcept
+		{
+			if (n * sizeof(T) < hugePageBytes)
+				return std::allocator<T>().deallocate(p, n);
+#ifdef _MSC_VER
+			_aligned_free(p);
+#else
+			free(p);
+#endif
+		}
+
+		template<typename U>
+		// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+		bool operator==(const HugePageAllocator<U>&) const noexcept
+		{
+			return true;
+		}
+
+		template<typename U>
+		// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+		bool operator!=(const HugePageAllocator<U>&) const noexcept
+		{
+			return false;
+		}
+	};
+}	 // namespace mm
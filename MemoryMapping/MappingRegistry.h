@@ -0,0 +1,149 @@
+#pragma once
+
+#include <MemoryMappedFile.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace mm
+{
+	struct MappingRegistryOptions
+	{
+		/// mappings no longer referenced by any handle are unmapped after this long
+		std::chrono::milliseconds idleTimeout { 30000 };
+		/**
+		 * a file acquired by name less than this long ago isn't checked again (a stat) for changes:
+		 * acquiring it then costs a hash lookup, but a file replaced in the meantime may be missed. 0 always checks
+		 */
+		std::chrono::milliseconds recheckInterval { 0 };
+		/// how files are mapped, e.g. MapOptions::lock to pin hot tables in RAM
+		MapOptions mapOptions {};
+	};
+
+	struct MappingRegistryStats
+	{
+		size_t hits = 0;
+		/// files mapped for the first time, or again after having been unmapped
+		size_t misses = 0;
+		/// files remapped as their modification time or size changed
+		size_t stale = 0;
+		/// idle mappings unmapped
+		size_t evictions = 0;
+		/// mappings currently held by the registry, and their size
+		size_t mappings = 0;
+		uint64_t mappedBytes = 0;
+		/// of which locked in RAM (see MapOptions::lock): less than mappedBytes if RLIMIT_MEMLOCK was too small
+		uint64_t lockedBytes = 0;
+	};
+
+	/**
+	 * Process-wide cache of read-only mappings of whole files, keyed by (device, inode), so that components opening the same file
+	 * (even through different paths) share one mapping, rather than each of them opening, mapping and unmapping it.
+	 * Acquire hands out reference-counted handles to the mapping: it stays mapped for as long as any of them exists, and for
+	 * idleTimeout afterwards, after which a helper thread unmaps it. A file whose modification time or size changed since it was
+	 * mapped is mapped again, while current handles keep the previous mapping: as any shared mapping, it sees what was written to
+	 * the file, and shouldn't be read past its new end. Files replaced by renaming another one over them are new files. Thread-safe
+	 */
+	class MappingRegistry
+	{
+	public:
+		/// the registry shared by the whole process
+		[[nodiscard]] static MappingRegistry& Instance();
+
+		explicit MappingRegistry(const MappingRegistryOptions& options = {});
+		~MappingRegistry() noexcept;
+
+		MappingRegistry(const MappingRegistry&) = delete;
+		MappingRegistry(MappingRegistry&&) = delete;
+		MappingRegistry& operator=(const MappingRegistry&) = delete;
+		MappingRegistry& operator=(MappingRegistry&&) = delete;
+
+		/**
+		 * mapping of the whole file, nullptr if it can't be opened or is empty. Files are mapped out of the registry lock, so that
+		 * lookups don't wait for them: threads acquiring the same file for the first time at once may each map it, and all get the first mapping
+		 */
+		[[nodiscard]] std::shared_ptr<const MappedRegion> Acquire(const std::string& fileName);
+
+		/// unmap the mappings no longer referenced by any handle now, regardless of the idle timeout
+		void Purge();
+
+		[[nodiscard]] MappingRegistryStats GetStats() const;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct FileIdentity
+		{
+			uint64_t device = 0;
+			uint64_t inode = 0;
+			int64_t modificationTime = 0;	 ///< nanoseconds
+			uint64_t size = 0;
+		};
+
+		struct Key
+		{
+			uint64_t device = 0;
+			uint64_t inode = 0;
+
+			// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+			bool operator==(const Key& rhs) const noexcept { return device == rhs.device && inode == rhs.inode; }
+		};
+
+		struct KeyHash
+		{
+			// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+			size_t operator()(const Key& key) const noexcept { return std::hash<uint64_t>()(key.device * 0x9E3779B97F4A7C15ull ^ key.inode); }
+		};
+
+		struct Entry
+		{
+			FileIdentity identity {};
+			std::shared_ptr<const MappedRegion> region {};
+			/// when the registry was found to hold the last reference, Clock::time_point::max() while handles exist
+			Clock::time_point idleSince = Clock::time_point::max();
+		};
+
+		struct NameEntry
+		{
+			Key key {};
+			Clock::time_point lastChecked {};
+		};
+
+		using Entries = std::unordered_map<Key, Entry, KeyHash>;
+
+		using MappedFile = MemoryMappedFile<CacheHint::RandomAccess, MapMode::ReadOnly>;
+
+		/// (device, inode) of the file, its modification time and size; false if it can't be opened or isn't a regular file
+		[[nodiscard]] static bool GetFileIdentity(const std::string& fileName, FileIdentity& identity) noexcept;
+		/// the same for the file actually mapped, which may not be the one fileName named when it was looked up
+		[[nodiscard]] static bool GetFileIdentity(const MappedFile& file, FileIdentity& identity) noexcept;
+#ifdef _MSC_VER
+		[[nodiscard]] static bool GetFileIdentity(MappedFile::FileHandle file, FileIdentity& identity) noexcept;
+#else
+		static void SetFileIdentity(const struct stat& statInfo, FileIdentity& identity) noexcept;
+#endif
+
+		/// drop the entry from the registry, and from the stats. Needs _mutex
+		Entries::iterator Erase(Entries::iterator entry);
+
+		/// unmap the idle mappings, or all the unreferenced ones if force. Needs _mutex
+		void Evict(Clock::time_point now, bool force);
+
+		void EvictionLoop();
+
+		MappingRegistryOptions _options;
+		mutable std::mutex _mutex {};
+		Entries _entries {};
+		/// names acquired within recheckInterval, for the lookups skipping GetFileIdentity
+		std::unordered_map<std::string, NameEntry> _names {};
+		MappingRegistryStats _stats {};
+
+		bool _stop = false;
+		std::condition_variable _cv {};
+		std::thread _evictionThread {};
+	};
+}	 // namespace mm
+
+#include <MappingRegistry.tpp>
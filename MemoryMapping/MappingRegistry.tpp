@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+	#include <windows.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+namespace mm
+{
+	inline MappingRegistry& MappingRegistry::Instance()
+	{
+		static MappingRegistry registry;
+		return registry;
+	}
+
+	inline MappingRegistry::MappingRegistry(const MappingRegistryOptions& options) : _options(options)
+	{
+		_evictionThread = std::thread(&MappingRegistry::EvictionLoop, this);
+	}
+
+	inline MappingRegistry::~MappingRegistry() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_cv.notify_all();
+		_evictionThread.join();
+	}
+
+	inline std::shared_ptr<const MappedRegion> MappingRegistry::Acquire(const std::string& fileName)
+	{
+		const auto now = Clock::now();
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		// recently checked: a hash lookup, no system call
+		if (_options.recheckInterval.count() > 0)
+		{
+			const auto name = _names.find(fileName);
+			if (name != _names.end() && now - name->second.lastChecked < _options.recheckInterval)
+			{
+				const auto entry = _entries.find(name->second.key);
+				if (entry != _entries.end())
+				{
+					++_stats.hits;
+					entry->second.idleSince = Clock::time_point::max();
+					return entry->second.region;
+				}
+			}
+		}
+
+		// system calls, and above all mapping (and maybe prefaulting or locking) a whole file, don't hold up the other lookups
+		lock.unlock();
+		FileIdentity identity;
+		if (!GetFileIdentity(fileName, identity))
+			return nullptr;
+
+		lock.lock();
+		auto entry = _entries.find(Key { identity.device, identity.inode });
+		if (entry != _entries.end() && entry->second.identity.modificationTime == identity.modificationTime && entry->second.identity.size == identity.size)
+		{
+			++_stats.hits;
+			entry->second.idleSince = Clock::time_point::max();
+			if (_options.recheckInterval.count() > 0)
+				_names[fileName] = NameEntry { entry->first, now };
+			return entry->second.region;
+		}
+		lock.unlock();
+
+		// the file may have been replaced since it was looked up: the entry describes the one actually mapped.
+		// The file descriptor is closed right away, as the region keeps the pages mapped
+		std::shared_ptr<const MappedRegion> region;
+		{
+			const MappedFile file(fileName, 0, _options.mapOptions);
+			region = file.GetRegion();
+			if (!region || !GetFileIdentity(file, identity))
+				return nullptr;
+		}
+		// written to since it was mapped: mapped again on the next lookup
+		identity.size = std::min<uint64_t>(identity.size, region->size());
+		const Key key { identity.device, identity.inode };
+
+		lock.lock();
+		if (_options.recheckInterval.count() > 0)
+			_names[fileName] = NameEntry { key, now };
+		entry = _entries.find(key);
+		if (entry != _entries.end())
+		{
+			// mapped by another thread in the meantime: this mapping is dropped, out of the lock
+			if (entry->second.identity.modificationTime == identity.modificationTime && entry->second.identity.size == identity.size)
+			{
+				++_stats.hits;
+				entry->second.idleSince = Clock::time_point::max();
+				auto ret = entry->second.region;
+				lock.unlock();
+				return ret;
+			}
+
+			// the file changed: current handles keep the previous mapping
+			++_stats.stale;
+			Erase(entry);
+		}
+		else
+			++_stats.misses;
+
+		_entries[key] = Entry { identity, region, Clock::time_point::max() };
+		++_stats.mappings;
+		_stats.mappedBytes += region->size();
+		if (region->IsLocked())
+			_stats.lockedBytes += region->size();
+		return region;
+	}
+
+	inline MappingRegistry::Entries::iterator MappingRegistry::Erase(Entries::iterator entry)
+	{
+		--_stats.mappings;
+		_stats.mappedBytes -= entry->second.region->size();
+		if (entry->second.region->IsLocked())
+			_stats.lockedBytes -= entry->second.region->size();
+		return _entries.erase(entry);
+	}
+
+	inline void MappingRegistry::Purge()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Evict(Clock::now(), true);
+	}
+
+	inline MappingRegistryStats MappingRegistry::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats;
+	}
+
+	inline bool MappingRegistry::GetFileIdentity(const std::string& fileName, FileIdentity& identity) noexcept
+	{
+#ifdef _MSC_VER
+		const HANDLE file = ::CreateFileA(fileName.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		const bool ret = GetFileIdentity(file, identity);
+		::CloseHandle(file);
+		return ret;
+#else
+		// a FIFO would block the open, and directories or devices can't be mapped
+		struct stat statInfo {};
+		if (::stat(fileName.c_str(), &statInfo) != 0 || !S_ISREG(statInfo.st_mode))
+			return false;
+
+		SetFileIdentity(statInfo, identity);
+		return true;
+#endif
+	}
+
+	inline bool MappingRegistry::GetFileIdentity(const MappedFile& file, FileIdentity& identity) noexcept
+	{
+#ifdef _MSC_VER
+		return GetFileIdentity(file.GetFileHandle(), identity);
+#else
+		struct stat statInfo {};
+		if (::fstat(file.GetFileHandle(), &statInfo) != 0)
+			return false;
+
+		SetFileIdentity(statInfo, identity);
+		return true;
+#endif
+	}
+
+#ifdef _MSC_VER
+	inline bool MappingRegistry::GetFileIdentity(const MappedFile::FileHandle file, FileIdentity& identity) noexcept
+	{
+		BY_HANDLE_FILE_INFORMATION info;
+		if (!::GetFileInformationByHandle(file, &info))
+			return false;
+
+		identity.device = info.dwVolumeSerialNumber;
+		identity.inode = (uint64_t { info.nFileIndexHigh } << 32) | info.nFileIndexLow;
+		identity.modificationTime = static_cast<int64_t>((uint64_t { info.ftLastWriteTime.dwHighDateTime } << 32) | info.ftLastWriteTime.dwLowDateTime) * 100;
+		identity.size = (uint64_t { info.nFileSizeHigh } << 32) | info.nFileSizeLow;
+		return true;
+	}
+#else
+	inline void MappingRegistry::SetFileIdentity(const struct stat& statInfo, FileIdentity& identity) noexcept
+	{
+		identity.device = static_cast<uint64_t>(statInfo.st_dev);
+		identity.inode = static_cast<uint64_t>(statInfo.st_ino);
+	#ifdef __APPLE__
+		identity.modificationTime = static_cast<int64_t>(statInfo.st_mtimespec.tv_sec) * 1000000000 + statInfo.st_mtimespec.tv_nsec;
+	#else
+		identity.modificationTime = static_cast<int64_t>(statInfo.st_mtim.tv_sec) * 1000000000 + statInfo.st_mtim.tv_nsec;
+	#endif
+		identity.size = static_cast<uint64_t>(statInfo.st_size);
+	}
+#endif
+
+	inline void MappingRegistry::Evict(const Clock::time_point now, const bool force)
+	{
+		for (auto entry = _entries.begin(); entry != _entries.end();)
+		{
+			// only the registry holds it
+			if (entry->second.region.use_count() > 1)
+			{
+				entry->second.idleSince = Clock::time_point::max();
+				++entry;
+				continue;
+			}
+
+			if (entry->second.idleSince == Clock::time_point::max())
+				entry->second.idleSince = now;
+			if (!force && now - entry->second.idleSince < _options.idleTimeout)
+			{
+				++entry;
+				continue;
+			}
+
+			++_stats.evictions;
+			entry = Erase(entry);
+		}
+
+		for (auto name = _names.begin(); name != _names.end();)
+		{
+			if (now - name->second.lastChecked >= _options.recheckInterval || _entries.find(name->second.key) == _entries.end())
+				name = _names.erase(name);
+			else
+				++name;
+		}
+	}
+
+	inline void MappingRegistry::EvictionLoop()
+	{
+		// idle mappings are unmapped between idleTimeout and twice idleTimeout after their last handle went away
+		const auto period = std::max(std::chrono::milliseconds(1), _options.idleTimeout / 2);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (!_stop)
+		{
+			_cv.wait_for(lock, period, [this]() { return _stop; });
+			if (!_stop)
+				Evict(Clock::now(), false);
+		}
+	}
+}	 // namespace mm
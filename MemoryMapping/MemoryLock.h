@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#ifdef _MSC_VER
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+namespace mm
+{
+	namespace detail
+	{
+		inline std::atomic<uint64_t>& LockedBytesCounter() noexcept
+		{
+			static std::atomic<uint64_t> lockedBytes { 0 };
+			return lockedBytes;
+		}
+	}	 // namespace detail
+
+	/// bytes currently locked in RAM by MemoryLocks (i.e. by locked mappings and arrays) in the whole process
+	[[nodiscard]] inline uint64_t LockedBytes() noexcept { return detail::LockedBytesCounter().load(std::memory_order_relaxed); }
+
+	/**
+	 * Locks the pages of a range of memory in RAM (mlock, VirtualLock on Windows) for its lifetime, faulting them in:
+	 * accessing them never takes a major fault, e.g. for tables on the critical path of latency sensitive services.
+	 * Locking is best effort: it fails if it would exceed RLIMIT_MEMLOCK (without CAP_IPC_LOCK), or the working set size on Windows,
+	 * in which case nothing is locked, and IsLocked() tells. Locks on overlapping pages don't nest: the first one unlocked unlocks them
+	 */
+	class MemoryLock
+	{
+	public:
+		MemoryLock() noexcept = default;
+
+		/// the whole pages holding [data, data + nBytes) are locked
+		MemoryLock(const void* data, size_t nBytes) noexcept
+		{
+			if (data == nullptr || nBytes == 0)
+				return;
+
+#ifdef _MSC_VER
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+			const bool locked = ::VirtualLock(const_cast<void*>(data), nBytes) != 0;
+#else
+			const bool locked = ::mlock(data, nBytes) == 0;
+#endif
+			if (!locked)
+				return;
+
+			_data = data;
+			_nBytes = nBytes;
+			detail::LockedBytesCounter().fetch_add(_nBytes, std::memory_order_relaxed);
+		}
+
+		~MemoryLock() noexcept { Unlock(); }
+
+		MemoryLock(const MemoryLock&) = delete;
+		MemoryLock& operator=(const MemoryLock&) = delete;
+
+		MemoryLock(MemoryLock&& rhs) noexcept : _data(std::exchange(rhs._data, nullptr)), _nBytes(std::exchange(rhs._nBytes, 0)) {}
+		MemoryLock& operator=(MemoryLock&& rhs) noexcept
+		{
+			if (this != &rhs)
+			{
+				Unlock();
+				_data = std::exchange(rhs._data, nullptr);
+				_nBytes = std::exchange(rhs._nBytes, 0);
+			}
+			return *this;
+		}
+
+		[[nodiscard]] bool IsLocked() const noexcept { return _data != nullptr; }
+
+		[[nodiscard]] size_t GetLockedBytes() const noexcept { return _nBytes; }
+
+		/// unlock now, rather than on destruction. Must happen before the memory is freed or unmapped
+		void Unlock() noexcept
+		{
+			if (_data == nullptr)
+				return;
+
+#ifdef _MSC_VER
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+			::VirtualUnlock(const_cast<void*>(_data), _nBytes);
+#else
+			::munlock(_data, _nBytes);
+#endif
+			detail::LockedBytesCounter().fetch_sub(_nBytes, std::memory_order_relaxed);
+			_data = nullptr;
+			_nBytes = 0;
+		}
+
+	private:
+		const void* _data = nullptr;
+		size_t _nBytes = 0;
+	};
+}	 // namespace mm
@@ -13,6 +13,7 @@ namespace mm
 	{
 		ReadOnly,
 		WriteOnly,
-		ReadAndWrite
+		ReadAndWrite,
+		CopyOnWrite     ///< private writable mapping (MAP_PRIVATE): only the pages written to are copied, the file is left untouched
 	};
 }
@@ -11,25 +11,108 @@ typedef unsigned __int64 uint64_t;
 	#include <cstdint>
 #endif
 
+#include <MemoryLock.h>
 #include <MemoryMapEnumerators.h>
+#include <NumaPolicy.h>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 namespace mm
 {
-	template<CacheHint = CacheHint::SequentialScan, MapMode = MapMode::ReadOnly>
+	/**
+	 * A mapped range of a file, unmapped when destroyed.
+	 * It's shared (see MemoryMappedFile::GetRegion) by whatever points into it, e.g. zero-copy array views: the pages stay mapped for as long
+	 * as any of them exists, even after the file has been closed or remapped
+	 */
+	class MappedRegion
+	{
+	public:
+		MappedRegion(void* address, size_t nBytes) noexcept : _address(address), _nBytes(nBytes) {}
+		~MappedRegion() noexcept;
+
+		MappedRegion(const MappedRegion&) = delete;
+		MappedRegion(MappedRegion&&) = delete;
+		MappedRegion& operator=(const MappedRegion&) = delete;
+		MappedRegion& operator=(MappedRegion&&) = delete;
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		[[nodiscard]] unsigned char* data() const noexcept { return reinterpret_cast<unsigned char*>(_address); }
+		[[nodiscard]] size_t size() const noexcept { return _nBytes; }
+
+		/// lock the region in RAM until it's unmapped, see MemoryLock. Returns false if it couldn't be locked
+		bool Lock() noexcept
+		{
+			_lock = MemoryLock(_address, _nBytes);
+			return _lock.IsLocked();
+		}
+
+		[[nodiscard]] bool IsLocked() const noexcept { return _lock.IsLocked(); }
+
+	private:
+		void* _address = nullptr;
+		size_t _nBytes = 0;
+		MemoryLock _lock {};
+	};
+
+	/// mapping offsets must be multiples of this: the page size, or the allocation granularity on Windows
+	[[nodiscard]] size_t PageSize() noexcept;
+
+	/// how the pages of a mapping are faulted in: by default lazily, on first access
+	struct MapOptions
+	{
+		/// fault the whole mapping in when mapping it (MAP_POPULATE), blocking until it's read. Like lock, it copies all the pages of MapMode::CopyOnWrite mappings
+		bool populate = false;
+		/// start reading the whole mapping ahead in the background (MADV_WILLNEED)
+		bool willNeed = false;
+		/// if not 0, touch every page of the mapping on as many threads when mapping it, see MemoryMappedFile::Prefault
+		size_t prefaultThreads = 0;
+		/// ask for transparent huge pages (MADV_HUGEPAGE), for files on tmpfs mounted with huge=advise or huge=within_size. Files on hugetlbfs
+		/// are always mapped with huge pages, but their mappings must then start at multiples of the huge page size
+		bool hugePages = false;
+		/**
+		 * lock the mapping in RAM (see MemoryLock), so that accessing it never takes a major fault. If that would exceed RLIMIT_MEMLOCK,
+		 * the mapping is only prefaulted, and left unlocked: MemoryMappedFile::IsLocked and mm::LockedBytes tell. MapMode::CopyOnWrite mappings are copied whole
+		 */
+		bool lock = false;
+		/// NUMA placement of the mapping (mbind), and of the page cache pages faulted in by Prefault (see ThreadNumaScope)
+		NumaPolicy numa {};
+		/// if not 0, pages more than releaseBehindBytes behind the current position (see Advance) are dropped from the mapping and from the
+		/// page cache, so that long sequential scans don't grow the resident set nor evict other files. Released pages are read again if revisited
+		size_t releaseBehindBytes = 0;
+	};
+
+	template<CacheHint ch = CacheHint::SequentialScan, MapMode mpm = MapMode::ReadOnly>
 	class MemoryMappedFile
 	{
 	public:
-		/// don't copy/move object
+#ifdef _MSC_VER
+		typedef void* FileHandle;
+#else
+		using FileHandle = int;
+#endif
+
+		/// the mapping is owned by a single object, but can be moved (e.g. returned from functions), and shared through GetRegion
 		MemoryMappedFile(const MemoryMappedFile&) = delete;
-		MemoryMappedFile(MemoryMappedFile&&) = delete;
 		MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
-		MemoryMappedFile& operator=(MemoryMappedFile&&) = delete;
+		MemoryMappedFile(MemoryMappedFile&& rhs) noexcept { Swap(rhs); }
+		MemoryMappedFile& operator=(MemoryMappedFile&& rhs) noexcept
+		{
+			if (this != &rhs)
+			{
+				Close();
+				Swap(rhs);
+			}
+			return *this;
+		}
 
 		/// open file, mappedBytes = 0 maps the whole file
-		explicit MemoryMappedFile(std::string filename, size_t mappedBytes = 0) noexcept : _filename(std::move(filename)), _mappedBytes(mappedBytes) { Open(); }
+		explicit MemoryMappedFile(std::string filename, size_t mappedBytes = 0, const MapOptions& options = {}) noexcept
+			: _filename(std::move(filename)), _mappedBytes(mappedBytes), _options(options)
+		{
+			Open();
+		}
 
 		/// close file (see close() )
 		~MemoryMappedFile() noexcept { Close(); }
@@ -43,16 +126,73 @@ namespace mm
 		// NOLINTNEXTLINE(fuchsia-overloaded-operator)
 		inline unsigned char operator[](size_t offset) const noexcept { return GetData()[offset]; }
 
+		[[nodiscard]] const MapOptions& GetOptions() const noexcept { return _options; }
+
 		/// get file size
 		[[nodiscard]] uint64_t size() const noexcept { return _fileSize; }
 
-		/// raw access
+		/// raw access, at the current position
 		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
 		[[nodiscard]] inline const unsigned char* GetData() const noexcept { return reinterpret_cast<unsigned char*>(_mappedView); }
 
+		/// raw access at offset from the start of the mapping, regardless of the current position
+		[[nodiscard]] inline const unsigned char* GetDataAt(const size_t offset) const noexcept { return _region->data() + offset; }
+
+		/// writable raw access, at the current position. With MapMode::CopyOnWrite, the pages written to are copied and the file is left untouched
+		[[nodiscard]] inline unsigned char* GetMutableData() noexcept
+		{
+			static_assert(mpm != MapMode::ReadOnly, "cannot write to a read-only mapping");
+			return static_cast<unsigned char*>(_mappedView);
+		}
+
+		/// writable raw access at offset from the start of the mapping, regardless of the current position
+		[[nodiscard]] inline unsigned char* GetMutableDataAt(const size_t offset) noexcept
+		{
+			static_assert(mpm != MapMode::ReadOnly, "cannot write to a read-only mapping");
+			return _region->data() + offset;
+		}
+
+		/// copy nElementsToRead from offset (from the start of the mapping) using memcpy, regardless of the current position
+		template<typename T>
+		void ReadAt(T* data, size_t offset, size_t nElementsToRead) const noexcept;
+
+		/// handle keeping the current mapping alive, nullptr if there's none
+		[[nodiscard]] std::shared_ptr<const MappedRegion> GetRegion() const noexcept { return _region; }
+
+		/// true if the current mapping is locked in RAM, see MapOptions::lock
+		[[nodiscard]] bool IsLocked() const noexcept { return _region && _region->IsLocked(); }
+
+		/// bytes currently mapped, starting at GetMappedOffset() in the file
+		[[nodiscard]] size_t GetMappedBytes() const noexcept { return _mappedBytes; }
+		[[nodiscard]] uint64_t GetMappedOffset() const noexcept { return _mappedOffset; }
+
+		/// handle of the open file, e.g. to tell which file is actually mapped; 0 once closed
+		[[nodiscard]] FileHandle GetFileHandle() const noexcept { return _fileHandle; }
+
+		/// ask the OS to read ahead nBytes from offset (from the start of the mapping) into the page cache, asynchronously (MADV_WILLNEED)
+		void Prefetch(size_t offset, size_t nBytes) const noexcept;
+
+		/**
+		 * Fault in nBytes from offset (from the start of the mapping), touching one byte per page on nThreads threads, and wait for it:
+		 * page faults are paid up front (e.g. at startup), and in parallel, rather than on first access. The mapping must be readable.
+		 * The pages of the threads that can't be started are touched on the calling thread
+		 */
+		void Prefault(size_t nThreads, size_t offset = 0, size_t nBytes = ~size_t { 0 }) const;
+
+		/**
+		 * drop the pages of [fileOffset, fileOffset + nBytes) of the file from the mapping (MADV_DONTNEED) and from the page cache (POSIX_FADV_DONTNEED).
+		 * With MapMode::CopyOnWrite, only from the page cache, as the pages written to would be lost
+		 */
+		void Release(uint64_t fileOffset, uint64_t nBytes) const noexcept;
+
 		/// advance the mappedView pointer
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		inline void Advance(const size_t nBytes) noexcept { _mappedView = reinterpret_cast<unsigned char*>(_mappedView) + nBytes; }
+		inline void Advance(const size_t nBytes) noexcept
+		{
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			_mappedView = reinterpret_cast<unsigned char*>(_mappedView) + nBytes;
+			if (_options.releaseBehindBytes != 0)
+				ReleaseBehind();
+		}
 
 		[[nodiscard]] std::string ReadLine(const size_t maxCharToRead = 256) noexcept;
 
@@ -70,10 +210,14 @@ namespace mm
 		template<typename T>
 		void Set(const T*& data) noexcept;
 
+		/// reinterpret mappedView pointer into writable data, for writable (e.g. copy-on-write) mappings
+		template<typename T>
+		void Set(T*& data) noexcept;
+
 		void ReadFrom(unsigned const char* data, const size_t nElementsToWrite) noexcept;
 
 		/// reqwind to the original mapped view pointer
-		void Rewind() noexcept { _mappedView = _originMappedView; }
+		void Rewind() noexcept { _mappedView = _region ? _region->data() : nullptr; }
 
 		/// true, if file successfully opened
 		[[nodiscard]] bool IsValid() const noexcept { return _mappedView != nullptr; }
@@ -82,22 +226,30 @@ namespace mm
 		bool ReMap(uint64_t offset, size_t mappedBytes);
 
 	private:
+		void Swap(MemoryMappedFile& rhs) noexcept;
+
+		/// release what's more than _options.releaseBehindBytes behind the current position, in batches of at least releaseBatchBytes
+		void ReleaseBehind() noexcept;
+		static constexpr size_t releaseBatchBytes { size_t { 1 } << 20 };
+
 		std::string _filename;
 		uint64_t _fileSize = 0;
 		size_t _mappedBytes = 0;
+		uint64_t _mappedOffset = 0;
+		MapOptions _options {};
+		/// bytes of the mapping already released behind the current position
+		size_t _releasedBytes = 0;
 
 #ifdef _MSC_VER
-		typedef void* FileHandle;
 		/// Windows handle to memory mapping of _file
 		void* _mappedFile = nullptr;
-#else
-		using FileHandle = int;
 #endif
 
 		FileHandle _fileHandle = 0;
 
+		/// current position
 		void* _mappedView = nullptr;
-		void* _originMappedView = nullptr;
+		std::shared_ptr<MappedRegion> _region {};
 	};
 }	 // namespace mm
 
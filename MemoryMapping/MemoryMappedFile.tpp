@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdio>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
 
 // OS-specific
 #ifdef _MSC_VER
@@ -31,11 +34,52 @@
 
 namespace mm
 {
+	inline MappedRegion::~MappedRegion() noexcept
+	{
+		if (_address == nullptr)
+			return;
+		_lock.Unlock();
+#ifdef _MSC_VER
+		::UnmapViewOfFile(_address);
+#else
+		::munmap(_address, _nBytes);
+#endif
+	}
+
+	inline size_t PageSize() noexcept
+	{
+#ifdef _MSC_VER
+		SYSTEM_INFO systemInfo;
+		::GetSystemInfo(&systemInfo);
+		return static_cast<size_t>(systemInfo.dwAllocationGranularity);
+#else
+		static const auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+		return pageSize;
+#endif
+	}
+
+	template<CacheHint ch, MapMode mpm>
+	void MemoryMappedFile<ch, mpm>::Swap(MemoryMappedFile& rhs) noexcept
+	{
+		std::swap(_filename, rhs._filename);
+		std::swap(_fileSize, rhs._fileSize);
+		std::swap(_mappedBytes, rhs._mappedBytes);
+		std::swap(_mappedOffset, rhs._mappedOffset);
+		std::swap(_options, rhs._options);
+		std::swap(_releasedBytes, rhs._releasedBytes);
+#ifdef _MSC_VER
+		std::swap(_mappedFile, rhs._mappedFile);
+#endif
+		std::swap(_fileHandle, rhs._fileHandle);
+		std::swap(_mappedView, rhs._mappedView);
+		std::swap(_region, rhs._region);
+	}
+
 	/// open file
 	template<CacheHint ch, MapMode mpm>
 	bool MemoryMappedFile<ch, mpm>::Open() noexcept
 	{
-		if (mpm != MapMode::ReadOnly)
+		if (mpm == MapMode::WriteOnly || mpm == MapMode::ReadAndWrite)
 			assert(_mappedBytes != 0);	  // size needs to be known when writing with mmap
 
 		// already open ?
@@ -71,6 +115,7 @@ namespace mm
 		switch (mpm)
 		{
 			case MapMode::ReadOnly:
+			case MapMode::CopyOnWrite:
 				_file = ::CreateFileA(_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, winHint, NULL);
 				break;
 			case MapMode::WriteOnly:
@@ -99,6 +144,9 @@ namespace mm
 			case MapMode::ReadAndWrite:
 				_mappedFile = ::CreateFileMapping(_file, NULL, PAGE_READWRITE, 0, 0, NULL);
 				break;
+			case MapMode::CopyOnWrite:
+				_mappedFile = ::CreateFileMapping(_file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+				break;
 			default:
 				break;
 		}
@@ -125,6 +173,7 @@ namespace mm
 		switch (mpm)
 		{
 			case MapMode::ReadOnly:
+			case MapMode::CopyOnWrite:
 				// NOLINTNEXTLINE(*)
 				_fileHandle = ::open(_filename.c_str(), O_RDONLY | O_LARGEFILE);
 				break;
@@ -163,17 +212,9 @@ namespace mm
 	template<CacheHint ch, MapMode mpm>
 	void MemoryMappedFile<ch, mpm>::Close() noexcept
 	{
-		Rewind();
-		// kill pointer
-		if (_mappedView != nullptr)
-		{
-#ifdef _MSC_VER
-			::UnmapViewOfFile(_mappedView);
-#else
-			::munmap(_mappedView, _fileSize);
-#endif
-			_mappedView = nullptr;
-		}
+		// unmapped once no view references it anymore
+		_region.reset();
+		_mappedView = nullptr;
 
 #ifdef _MSC_VER
 		if (_mappedFile)
@@ -201,29 +242,25 @@ namespace mm
 	template<CacheHint ch, MapMode mpm>
 	bool MemoryMappedFile<ch, mpm>::ReMap(uint64_t offset, size_t mappedBytes)
 	{
+		// close old mapping, once no view references it anymore: on failure, nothing is left mapped
+		_region.reset();
+		_mappedView = nullptr;
+		_mappedBytes = 0;
+		_mappedOffset = 0;
+
 		if (_fileHandle == 0)
 			return false;
 
 		if (mappedBytes == 0)
 			mappedBytes = _fileSize;
 
-		// close old mapping
-		if (_mappedView != nullptr)
-		{
-			Rewind();
-#ifdef _MSC_VER
-			::UnmapViewOfFile(_mappedView);
-#else
-			::munmap(_mappedView, mappedBytes);
-#endif
-			_mappedView = nullptr;
-		}
-
 		// don't go further than end of file
 		if (offset > _fileSize)
 			return false;
 		if (offset + mappedBytes > _fileSize)
 			mappedBytes = size_t(_fileSize - offset);
+		if (mappedBytes == 0)
+			return false;
 
 		_mappedBytes = mappedBytes;
 
@@ -245,39 +282,50 @@ namespace mm
 			case MapMode::ReadAndWrite:
 				_mappedView = ::MapViewOfFile(_mappedFile, FILE_MAP_ALL_ACCESS, offsetHigh, offsetLow, _mappedBytes);
 				break;
+			case MapMode::CopyOnWrite:
+				_mappedView = ::MapViewOfFile(_mappedFile, FILE_MAP_COPY, offsetHigh, offsetLow, _mappedBytes);
+				break;
 			default:
 				break;
 		}
 
-		_originMappedView = _mappedView;
-
 		if (!_mappedView)
 		{
 			_mappedBytes = 0;
 			_mappedView = nullptr;
-			_originMappedView = nullptr;
 			return false;
 		}
 
-		return true;
-
+		_region = std::make_shared<MappedRegion>(_mappedView, _mappedBytes);
+		_mappedOffset = offset;
+		_releasedBytes = 0;
 #else
 
 		// Linux
+	#ifdef MAP_POPULATE
+		const int populateFlag = _options.populate ? MAP_POPULATE : 0;
+	#else
+		const int populateFlag = 0;
+	#endif
+
 		// new mapping
 		switch (mpm)
 		{
 			case MapMode::ReadOnly:
 				// NOLINTNEXTLINE(*)
-				_mappedView = ::mmap64(nullptr, _mappedBytes, PROT_READ, MAP_SHARED, _fileHandle, static_cast<long>(offset));
+				_mappedView = ::mmap64(nullptr, _mappedBytes, PROT_READ, MAP_SHARED | populateFlag, _fileHandle, static_cast<long>(offset));
 				break;
 			case MapMode::WriteOnly:
 				// NOLINTNEXTLINE(*)
-				_mappedView = ::mmap64(nullptr, _mappedBytes, PROT_WRITE, MAP_SHARED, _fileHandle, static_cast<long>(offset));
+				_mappedView = ::mmap64(nullptr, _mappedBytes, PROT_WRITE, MAP_SHARED | populateFlag, _fileHandle, static_cast<long>(offset));
 				break;
 			case MapMode::ReadAndWrite:
 				// NOLINTNEXTLINE(*)
-				_mappedView = ::mmap64(nullptr, _mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fileHandle, static_cast<long>(offset));
+				_mappedView = ::mmap64(nullptr, _mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | populateFlag, _fileHandle, static_cast<long>(offset));
+				break;
+			case MapMode::CopyOnWrite:
+				// NOLINTNEXTLINE(*)
+				_mappedView = ::mmap64(nullptr, _mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | populateFlag, _fileHandle, static_cast<long>(offset));
 				break;
 			default:
 				// NOLINTNEXTLINE(*)
@@ -285,18 +333,19 @@ namespace mm
 				break;
 		}
 
-		_originMappedView = _mappedView;
-
 		// NOLINTNEXTLINE(*)
 		if (_mappedView == MAP_FAILED)
 		{
-			perror("mmap");
+			// e.g. a directory, or a device that can't be mapped
 			_mappedBytes = 0;
 			_mappedView = nullptr;
-			_originMappedView = nullptr;
-			std::abort();
+			return false;
 		}
 
+		_region = std::make_shared<MappedRegion>(_mappedView, _mappedBytes);
+		_mappedOffset = offset;
+		_releasedBytes = 0;
+
 		// tweak performance
 		int linuxHint = 0;
 		switch (ch)
@@ -315,11 +364,143 @@ namespace mm
 		}
 
 		::madvise(_mappedView, _mappedBytes, linuxHint);
+	#ifdef MADV_HUGEPAGE
+		if (_options.hugePages)
+			::madvise(_mappedView, _mappedBytes, MADV_HUGEPAGE);
+	#endif
+#endif
+
+		ApplyNumaPolicy(_mappedView, _mappedBytes, _options.numa, PageSize());
+		if (_options.willNeed)
+			Prefetch(0, _mappedBytes);
+#ifdef _MSC_VER
+		// no MAP_POPULATE
+		if (_options.populate)
+			Prefault(1);
+#endif
+		if (_options.prefaultThreads != 0)
+			Prefault(_options.prefaultThreads);
+
+		// over RLIMIT_MEMLOCK, the pages are at least faulted in now (but may be evicted later)
+		if (_options.lock && !_region->Lock() && _options.prefaultThreads == 0)
+			Prefault(1);
 
 		return true;
+	}
+
+	template<CacheHint ch, MapMode mpm>
+	void MemoryMappedFile<ch, mpm>::Prefetch(size_t offset, size_t nBytes) const noexcept
+	{
+		if (!_region || offset >= _region->size())
+			return;
+		nBytes = std::min(nBytes, _region->size() - offset);
+
+		// madvise wants a page aligned address, and the mapping starts on a page boundary
+		const size_t pageOffset = offset % PageSize();
+		offset -= pageOffset;
+		nBytes += pageOffset;
+#ifdef _MSC_VER
+		WIN32_MEMORY_RANGE_ENTRY range { _region->data() + offset, nBytes };
+		::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+#else
+		::madvise(_region->data() + offset, nBytes, MADV_WILLNEED);
+#endif
+	}
+
+	template<CacheHint ch, MapMode mpm>
+	void MemoryMappedFile<ch, mpm>::Prefault(size_t nThreads, const size_t offset, size_t nBytes) const
+	{
+		if (!_region || offset >= _region->size())
+			return;
+		nBytes = std::min(nBytes, _region->size() - offset);
+
+		const size_t pageSize = PageSize();
+		const size_t firstPage = offset / pageSize;
+		const size_t nPages = (offset + nBytes + pageSize - 1) / pageSize - firstPage;
+		nThreads = std::max<size_t>(1, std::min(nThreads, nPages));
+
+		// reading is enough to map the page (writable mappings fault once more, without I/O, on the first write)
+		const auto touch = [&](const size_t begin, const size_t end)
+		{
+			// the NUMA part of the mapping holding the first page
+			const auto nNodes = _options.numa.GetNodes().size();
+			size_t part = 0;
+			while (part + 1 < nNodes && NumaPartBegin(_region->size(), nNodes, pageSize, part + 1) <= begin * pageSize)
+				++part;
+			const ThreadNumaScope numaScope(_options.numa, part);
+
+			unsigned char sum = 0;
+			for (size_t page = begin; page < end; ++page)
+				sum = static_cast<unsigned char>(sum + *static_cast<volatile const unsigned char*>(_region->data() + page * pageSize));
+			[[maybe_unused]] volatile unsigned char sink = sum;
+		};
+
+		// contiguous ranges of pages, so that each thread's faults are sequential for the readahead
+		std::vector<std::thread> threads;
+		threads.reserve(nThreads - 1);
+		const size_t pagesPerThread = (nPages + nThreads - 1) / nThreads;
+		for (size_t i = 1; i < nThreads; ++i)
+		{
+			const size_t begin = firstPage + std::min(nPages, i * pagesPerThread);
+			const size_t end = std::min(firstPage + nPages, begin + pagesPerThread);
+			// e.g. out of threads: Open and ReMap can't throw
+			try
+			{
+				threads.emplace_back(touch, begin, end);
+			}
+			catch (const std::system_error&)
+			{
+				touch(begin, end);
+			}
+		}
+		touch(firstPage, firstPage + std::min(nPages, pagesPerThread));
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	template<CacheHint ch, MapMode mpm>
+	void MemoryMappedFile<ch, mpm>::Release(uint64_t fileOffset, uint64_t nBytes) const noexcept
+	{
+#ifdef _MSC_VER
+		// file views can't be discarded without unmapping them: the pages are left to the working set manager
+		(void)fileOffset;
+		(void)nBytes;
+#else
+		if (_fileHandle == 0 || nBytes == 0)
+			return;
+
+		// only whole pages, as the ones at the edges may still be in use
+		const size_t pageSize = PageSize();
+		const uint64_t begin = (fileOffset + pageSize - 1) / pageSize * pageSize;
+		const uint64_t end = std::min<uint64_t>(fileOffset + nBytes, _fileSize) / pageSize * pageSize;
+		if (begin >= end)
+			return;
+
+		const uint64_t mappedBegin = std::max(begin, _mappedOffset);
+		const uint64_t mappedEnd = std::min<uint64_t>(end, _mappedOffset + (_region ? _region->size() : 0) / pageSize * pageSize);
+		// discarding private pages would lose what was written to them
+		if (mappedBegin < mappedEnd && mpm != MapMode::CopyOnWrite)
+			::madvise(_region->data() + (mappedBegin - _mappedOffset), static_cast<size_t>(mappedEnd - mappedBegin), MADV_DONTNEED);
+		::posix_fadvise(_fileHandle, static_cast<off_t>(begin), static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
 #endif
 	}
 
+	template<CacheHint ch, MapMode mpm>
+	void MemoryMappedFile<ch, mpm>::ReleaseBehind() noexcept
+	{
+		if (!_region)
+			return;
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto position = static_cast<size_t>(reinterpret_cast<unsigned char*>(_mappedView) - _region->data());
+		if (position < _options.releaseBehindBytes + releaseBatchBytes || position - _options.releaseBehindBytes < _releasedBytes + releaseBatchBytes)
+			return;
+
+		const size_t releaseEnd = (position - _options.releaseBehindBytes) / PageSize() * PageSize();
+		Release(_mappedOffset + _releasedBytes, releaseEnd - _releasedBytes);
+		_releasedBytes = releaseEnd;
+	}
+
 	template<CacheHint ch, MapMode mpm>
 	std::string MemoryMappedFile<ch, mpm>::ReadLine(const size_t maxCharToRead) noexcept
 	{
@@ -348,6 +529,13 @@ namespace mm
 		std::memcpy(data, buffer, sizeof(T) * nElementsToRead);
 	}
 
+	template<CacheHint ch, MapMode mpm>
+	template<typename T>
+	void MemoryMappedFile<ch, mpm>::ReadAt(T* data, const size_t offset, const size_t nElementsToRead) const noexcept
+	{
+		std::memcpy(data, GetDataAt(offset), sizeof(T) * nElementsToRead);
+	}
+
 	template<CacheHint ch, MapMode mpm>
 	template<typename T>
 	void MemoryMappedFile<ch, mpm>::Set(const T*& data) noexcept
@@ -357,6 +545,14 @@ namespace mm
 		data = reinterpret_cast<const T*>(buffer);
 	}
 
+	template<CacheHint ch, MapMode mpm>
+	template<typename T>
+	void MemoryMappedFile<ch, mpm>::Set(T*& data) noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		data = reinterpret_cast<T*>(GetMutableData());
+	}
+
 	template<CacheHint ch, MapMode mpm>
 	void MemoryMappedFile<ch, mpm>::ReadFrom(unsigned const char* data, const size_t nElementsToWrite) noexcept
 	{
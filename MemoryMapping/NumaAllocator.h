@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef _MSC_VER
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+namespace mm
+{
+	namespace detail
+	{
+		/// see NumaAllocator(LeaveUninitialized)
+		struct LeaveUninitialized
+		{
+		};
+	}	 // namespace detail
+
+	/**
+	 * Allocator for arrays placed on NUMA nodes (see ApplyNumaPolicy and ThreadNumaScope): allocations are fresh anonymous mappings,
+	 * whose pages aren't backed until first touched, so that they land where the policy of the mapping (mbind), or else of the
+	 * thread touching them first, puts them
+	 */
+	template<typename T>
+	class NumaAllocator
+	{
+	public:
+		using value_type = T;
+
+		NumaAllocator() noexcept = default;
+
+		/**
+		 * Value initialization of trivially copyable elements is skipped, so that resizing doesn't touch the pages: only for buffers
+		 * entirely overwritten right away (see npypp::LoadFull), and to be moved to a vector with a default constructed allocator then
+		 */
+		explicit NumaAllocator(detail::LeaveUninitialized) noexcept : _leaveUninitialized(true) {}
+
+		template<typename U>
+		// NOLINTNEXTLINE(google-explicit-constructor)
+		NumaAllocator(const NumaAllocator<U>& rhs) noexcept : _leaveUninitialized(rhs._leaveUninitialized)
+		{
+		}
+
+		[[nodiscard]] size_t max_size() const noexcept { return std::numeric_limits<size_t>::max() / 2 / sizeof(T); }
+
+		[[nodiscard]] T* allocate(const size_t n)
+		{
+			if (n > max_size())
+				throw std::bad_array_new_length();
+			if (n == 0)
+				return nullptr;
+
+#ifdef _MSC_VER
+			void* ret = ::VirtualAlloc(nullptr, n * sizeof(T), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+			void* ret = ::mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			// NOLINTNEXTLINE(*)
+			if (ret == MAP_FAILED)
+				ret = nullptr;
+#endif
+			if (ret == nullptr)
+				throw std::bad_alloc();
+			return static_cast<T*>(ret);
+		}
+
+		void deallocate(T* p, const size_t n) noexcept
+		{
+			if (p == nullptr)
+				return;
+#ifdef _MSC_VER
+			(void)n;
+			::VirtualFree(p, 0, MEM_RELEASE);
+#else
+			::munmap(p, n * sizeof(T));
+#endif
+		}
+
+		template<typename U>
+		void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value)
+		{
+			if constexpr (std::is_trivially_copyable<U>::value)
+			{
+				if (_leaveUninitialized)
+					return;
+			}
+			::new (static_cast<void*>(p)) U();
+		}
+
+		template<typename U, typename... Args>
+		void construct(U* p, Args&&... args)
+		{
+			::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+		}
+
+		template<typename U>
+		// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+		bool operator==(const NumaAllocator<U>&) const noexcept
+		{
+			return true;
+		}
+
+		template<typename U>
+		// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+		bool operator!=(const NumaAllocator<U>&) const noexcept
+		{
+			return false;
+		}
+
+	private:
+		template<typename U>
+		friend class NumaAllocator;
+
+		bool _leaveUninitialized = false;
+	};
+}	 // namespace mm
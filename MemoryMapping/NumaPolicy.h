@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+	#include <sched.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+namespace mm
+{
+	enum class NumaPlacement
+	{
+		Default,	   ///< first touch: pages land on the node of the thread touching them first
+		Interleave,	   ///< pages spread round-robin over the nodes
+		Bind,		   ///< all pages on one node
+		Partition	   ///< contiguous parts (e.g. ranges of rows), one per node, to be processed by threads running on that node
+	};
+
+	struct NumaPolicy
+	{
+		NumaPlacement placement = NumaPlacement::Default;
+		/// for NumaPlacement::Bind
+		unsigned node = 0;
+		/// for NumaPlacement::Interleave and NumaPlacement::Partition, all the nodes if empty
+		std::vector<unsigned> nodes {};
+
+		[[nodiscard]] std::vector<unsigned> GetNodes() const;
+	};
+
+	namespace detail
+	{
+		// from linux/mempolicy.h, so that neither libnuma nor its headers are needed
+		constexpr int mpolDefault { 0 };
+		constexpr int mpolBind { 2 };
+		constexpr int mpolInterleave { 3 };
+		constexpr unsigned mpolMfMove { 1u << 1 };
+
+		/// node ranges as in /sys/devices/system/node/*, e.g. "0-3,8"
+		inline std::vector<unsigned> ParseNodeList(const std::string& fileName)
+		{
+			std::ifstream file(fileName);
+			std::string list;
+			std::vector<unsigned> ret;
+			if (!std::getline(file, list))
+				return ret;
+
+			size_t start = 0;
+			while (start < list.size())
+			{
+				const size_t end = std::min(list.find(',', start), list.size());
+				const std::string range = list.substr(start, end - start);
+				const size_t dash = range.find('-');
+				try
+				{
+					const auto first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+					const auto last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+					for (unsigned i = first; i <= last; ++i)
+						ret.push_back(i);
+				}
+				catch (const std::exception&)
+				{
+					return {};
+				}
+				start = end + 1;
+			}
+			return ret;
+		}
+
+		/// bit mask of nodes, as taken by mbind and set_mempolicy
+		inline std::vector<unsigned long> NodeMask(const std::vector<unsigned>& nodes)
+		{
+			constexpr unsigned bitsPerWord { 8 * sizeof(unsigned long) };
+			const unsigned maxNode = nodes.empty() ? 0 : *std::max_element(nodes.begin(), nodes.end());
+			std::vector<unsigned long> mask(maxNode / bitsPerWord + 1, 0);
+			for (const auto node : nodes)
+				mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+			return mask;
+		}
+
+		/// the kernel ignores the last bit of maxnode
+		inline unsigned long MaxNode(const std::vector<unsigned long>& mask) noexcept { return mask.size() * 8 * sizeof(unsigned long) + 1; }
+
+		inline bool MemoryBind(const void* data, const size_t nBytes, const int mode, const std::vector<unsigned>& nodes) noexcept
+		{
+#ifdef __linux__
+			const auto mask = NodeMask(nodes);
+			return ::syscall(SYS_mbind, data, nBytes, mode, mask.data(), MaxNode(mask), mpolMfMove) == 0;
+#else
+			(void)data;
+			(void)nBytes;
+			(void)mode;
+			(void)nodes;
+			return false;
+#endif
+		}
+	}	 // namespace detail
+
+	/// nodes of the system, just 0 where that can't be told (or on other platforms than Linux)
+	[[nodiscard]] inline std::vector<unsigned> NumaNodes()
+	{
+		static const std::vector<unsigned> nodes = []()
+		{
+			auto ret = detail::ParseNodeList("/sys/devices/system/node/online");
+			return ret.empty() ? std::vector<unsigned> { 0 } : ret;
+		}();
+		return nodes;
+	}
+
+	inline std::vector<unsigned> NumaPolicy::GetNodes() const
+	{
+		if (placement == NumaPlacement::Bind)
+			return { node };
+		return nodes.empty() ? NumaNodes() : nodes;
+	}
+
+	/// start of part `part` (out of nParts) of nBytes, split at multiples of granularity (e.g. the size of a row)
+	[[nodiscard]] inline size_t NumaPartBegin(const size_t nBytes, const size_t nParts, const size_t granularity, const size_t part) noexcept
+	{
+		const size_t nUnits = nBytes / granularity;
+		return std::min(nBytes, nUnits * part / nParts * granularity);
+	}
+
+	/**
+	 * Place [data, data + nBytes) according to policy (mbind, moving the pages already there), before it's first touched:
+	 * with NumaPlacement::Partition, part i of NumaPartBegin(nBytes, nodes.size(), granularity, i) goes to nodes[i].
+	 * Only whole pages are placed. Returns false where it's not supported (e.g. kernels without NUMA, other platforms)
+	 */
+	inline bool ApplyNumaPolicy(const void* data, const size_t nBytes, const NumaPolicy& policy, const size_t granularity = 1)
+	{
+		if (policy.placement == NumaPlacement::Default || data == nullptr || nBytes == 0)
+			return true;
+
+#ifdef __linux__
+		const auto pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto address = reinterpret_cast<uintptr_t>(data);
+		const auto place = [&](const size_t begin, const size_t end, const int mode, const std::vector<unsigned>& nodes)
+		{
+			const uintptr_t first = (address + begin + pageSize - 1) / pageSize * pageSize;
+			const uintptr_t last = (address + end) / pageSize * pageSize;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+			return first >= last || detail::MemoryBind(reinterpret_cast<const void*>(first), last - first, mode, nodes);
+		};
+
+		const auto nodes = policy.GetNodes();
+		switch (policy.placement)
+		{
+			case NumaPlacement::Interleave:
+				return place(0, nBytes, detail::mpolInterleave, nodes);
+			case NumaPlacement::Bind:
+				return place(0, nBytes, detail::mpolBind, nodes);
+			case NumaPlacement::Partition:
+			{
+				bool ret = true;
+				for (size_t i = 0; i < nodes.size(); ++i)
+					ret &= place(NumaPartBegin(nBytes, nodes.size(), granularity, i), NumaPartBegin(nBytes, nodes.size(), granularity, i + 1), detail::mpolBind, { nodes[i] });
+				return ret;
+			}
+			default:
+				return true;
+		}
+#else
+		(void)granularity;
+		return false;
+#endif
+	}
+
+	/**
+	 * For its lifetime, the calling thread allocates the memory it touches first according to policy (set_mempolicy), and,
+	 * if that's a single node (NumaPlacement::Bind, or part `part` of NumaPlacement::Partition), runs on the CPUs of that node.
+	 * Pages of the page cache, which mbind doesn't apply to, are placed this way. Both are back to what they were afterwards, so that scopes nest
+	 */
+	class ThreadNumaScope
+	{
+	public:
+		explicit ThreadNumaScope(const NumaPolicy& policy, const size_t part = 0)
+		{
+#ifdef __linux__
+			if (policy.placement == NumaPlacement::Default)
+				return;
+
+			const auto nodes = policy.GetNodes();
+			std::vector<unsigned> scopeNodes { nodes[part % nodes.size()] };
+			const int mode = policy.placement == NumaPlacement::Interleave ? detail::mpolInterleave : detail::mpolBind;
+			if (mode == detail::mpolInterleave)
+				scopeNodes = nodes;
+
+			// the policy isn't changed if it can't be restored
+			if (::syscall(SYS_get_mempolicy, &_previousMode, _previousMask.data(), _previousMask.size() * 8 * sizeof(unsigned long), nullptr, 0) != 0)
+				return;
+			const auto mask = detail::NodeMask(scopeNodes);
+			_policySet = ::syscall(SYS_set_mempolicy, mode, mask.data(), detail::MaxNode(mask)) == 0;
+
+			if (mode == detail::mpolBind && ::sched_getaffinity(0, sizeof(_affinity), &_affinity) == 0)
+			{
+				cpu_set_t affinity;
+				CPU_ZERO(&affinity);
+				for (const auto cpu : detail::ParseNodeList("/sys/devices/system/node/node" + std::to_string(scopeNodes.front()) + "/cpulist"))
+					if (cpu < CPU_SETSIZE)
+						CPU_SET(cpu, &affinity);
+				_affinitySet = CPU_COUNT(&affinity) > 0 && ::sched_setaffinity(0, sizeof(affinity), &affinity) == 0;
+			}
+#else
+			(void)policy;
+			(void)part;
+#endif
+		}
+
+		~ThreadNumaScope() noexcept
+		{
+#ifdef __linux__
+			if (_policySet)
+				::syscall(SYS_set_mempolicy, _previousMode, _previousMask.data(), detail::MaxNode(_previousMask));
+			if (_affinitySet)
+				::sched_setaffinity(0, sizeof(_affinity), &_affinity);
+#endif
+		}
+
+		ThreadNumaScope(const ThreadNumaScope&) = delete;
+		ThreadNumaScope(ThreadNumaScope&&) = delete;
+		ThreadNumaScope& operator=(const ThreadNumaScope&) = delete;
+		ThreadNumaScope& operator=(ThreadNumaScope&&) = delete;
+
+	private:
+		bool _policySet = false;
+#ifdef __linux__
+		bool _affinitySet = false;
+		cpu_set_t _affinity {};
+		/// the policy of the thread before the scope, for up to 1024 nodes (as libnuma)
+		int _previousMode = detail::mpolDefault;
+		std::vector<unsigned long> _previousMask = std::vector<unsigned long>(1024 / (8 * sizeof(unsigned long)), 0);
+#endif
+	};
+}	 // namespace mm
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <MemoryMappedFile.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace mm
+{
+	/**
+	 * Sequential reader of files larger than the address space one is willing to map (e.g. under RLIMIT_AS):
+	 * only a window of the file is mapped at any time, moved forward (at page aligned offsets) as the position crosses its end.
+	 * Reads straddling two windows are stitched together, so that elements don't need to be aligned to the window size.
+	 * With prefetching, the next window is mapped and read ahead (MADV_WILLNEED) by a helper thread while the current one is consumed:
+	 * at most 2 windows are mapped at once, regardless of the file size.
+	 * Not thread-safe: a reader is meant to be used by one thread
+	 */
+	template<CacheHint ch = CacheHint::SequentialScan>
+	class WindowedMappedFile
+	{
+	public:
+		static constexpr size_t defaultWindowBytes { size_t { 1 } << 28 };
+
+		/**
+		 * windowBytes is rounded up to a multiple of the page size. options apply to every window; options.releaseBehindBytes
+		 * trails the position of the reader, rather than the one of the window
+		 */
+		explicit WindowedMappedFile(std::string filename, size_t windowBytes = defaultWindowBytes, bool prefetch = true, const MapOptions& options = {});
+
+		~WindowedMappedFile() noexcept;
+
+		WindowedMappedFile(const WindowedMappedFile&) = delete;
+		WindowedMappedFile(WindowedMappedFile&&) = delete;
+		WindowedMappedFile& operator=(const WindowedMappedFile&) = delete;
+		WindowedMappedFile& operator=(WindowedMappedFile&&) = delete;
+
+		[[nodiscard]] bool IsValid() const noexcept { return _window.IsValid(); }
+
+		/// file size
+		[[nodiscard]] uint64_t size() const noexcept { return _window.size(); }
+
+		[[nodiscard]] size_t GetWindowBytes() const noexcept { return _windowBytes; }
+
+		/// offset in the file of the current window
+		[[nodiscard]] uint64_t GetWindowOffset() const noexcept { return _window.GetMappedOffset(); }
+
+		/// current position in the file
+		[[nodiscard]] uint64_t GetPosition() const noexcept { return _position; }
+
+		/// move to an arbitrary position: the window is moved on the next read, if needed
+		void Seek(uint64_t position) noexcept { _position = std::min(position, size()); }
+
+		void Skip(uint64_t nBytes) noexcept { Seek(_position + nBytes); }
+
+		[[nodiscard]] bool IsEof() const noexcept { return _position >= size(); }
+
+		/// copy up to nElements from the current position, and advance past them. Returns the number of elements read, short only at the end of the file
+		template<typename T>
+		size_t Read(T* data, size_t nElements);
+
+		template<typename T>
+		inline size_t Read(std::vector<T>& data)
+		{
+			return Read(data.data(), data.size());
+		}
+
+		/**
+		 * nBytes of contiguous data at the current position, and advance past them; nullptr if the file is shorter.
+		 * Points into the window, or, for data straddling two windows, to a copy: it's valid until the next call.
+		 * Also nullptr if the window can't be mapped, e.g. at the end of the file
+		 */
+		[[nodiscard]] const unsigned char* Next(size_t nBytes);
+
+	private:
+		/// release what's more than releaseBehindBytes behind the current position, from the page cache too (as the windows are unmapped anyway)
+		void ReleaseBehind() noexcept;
+
+		/// map the window holding the current position, swapping in the prefetched one if it's there. False if it can't be mapped
+		[[nodiscard]] bool MoveWindow();
+
+		/// have the helper thread map and read ahead the window after the current one
+		void RequestNext();
+
+		/// wait for the helper thread to be idle, after which _next can be touched
+		void WaitNext();
+
+		void PrefetchLoop();
+
+		size_t _windowBytes;
+		size_t _releaseBehindBytes;
+		uint64_t _position = 0;
+		uint64_t _releasedOffset = 0;
+		MemoryMappedFile<ch, MapMode::ReadOnly> _window;
+		std::vector<unsigned char> _straddleBuffer {};
+
+		// the window after _window, (re)mapped by _prefetchThread
+		MemoryMappedFile<ch, MapMode::ReadOnly> _next;
+		uint64_t _nextOffset = 0;
+		bool _nextRequested = false;
+		bool _stop = false;
+		std::mutex _mutex {};
+		std::condition_variable _cv {};
+		std::thread _prefetchThread {};
+	};
+}	 // namespace mm
+
+#include <WindowedMappedFile.tpp>
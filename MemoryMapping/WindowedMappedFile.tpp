@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstring>
+
+namespace mm
+{
+	template<CacheHint ch>
+	WindowedMappedFile<ch>::WindowedMappedFile(std::string filename, const size_t windowBytes, const bool prefetch, const MapOptions& options)
+		: _windowBytes((std::max<size_t>(windowBytes, 1) + PageSize() - 1) / PageSize() * PageSize()),
+		  _releaseBehindBytes(options.releaseBehindBytes),
+		  _window(filename, _windowBytes, options),
+		  _next(std::move(filename), PageSize(), options)
+	{
+		// nothing to prefetch if the file fits in a window
+		if (!prefetch || !IsValid() || size() <= _windowBytes)
+		{
+			_next.Close();
+			return;
+		}
+
+		_prefetchThread = std::thread(&WindowedMappedFile::PrefetchLoop, this);
+		RequestNext();
+	}
+
+	template<CacheHint ch>
+	WindowedMappedFile<ch>::~WindowedMappedFile() noexcept
+	{
+		if (!_prefetchThread.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_cv.notify_all();
+		_prefetchThread.join();
+	}
+
+	template<CacheHint ch>
+	template<typename T>
+	size_t WindowedMappedFile<ch>::Read(T* data, const size_t nElements)
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto* out = reinterpret_cast<unsigned char*>(data);
+		const auto nBytes = static_cast<size_t>(std::min<uint64_t>(nElements * sizeof(T), (size() - _position) / sizeof(T) * sizeof(T)));
+
+		size_t bytesRead = 0;
+		while (bytesRead < nBytes)
+		{
+			if (!MoveWindow())
+				break;
+			const auto windowOffset = static_cast<size_t>(_position - GetWindowOffset());
+			const auto chunkBytes = std::min(nBytes - bytesRead, _window.GetMappedBytes() - windowOffset);
+			std::memcpy(out + bytesRead, _window.GetDataAt(windowOffset), chunkBytes);
+			bytesRead += chunkBytes;
+			_position += chunkBytes;
+		}
+		if (_releaseBehindBytes != 0)
+			ReleaseBehind();
+
+		return bytesRead / sizeof(T);
+	}
+
+	template<CacheHint ch>
+	const unsigned char* WindowedMappedFile<ch>::Next(const size_t nBytes)
+	{
+		if (nBytes > size() - _position)
+			return nullptr;
+
+		if (!MoveWindow())
+			return nullptr;
+		const auto windowOffset = static_cast<size_t>(_position - GetWindowOffset());
+		if (windowOffset + nBytes <= _window.GetMappedBytes())
+		{
+			_position += nBytes;
+			if (_releaseBehindBytes != 0)
+				ReleaseBehind();
+			return _window.GetDataAt(windowOffset);
+		}
+
+		_straddleBuffer.resize(nBytes);
+		if (Read(_straddleBuffer.data(), nBytes) != nBytes)
+			return nullptr;
+		return _straddleBuffer.data();
+	}
+
+	template<CacheHint ch>
+	void WindowedMappedFile<ch>::ReleaseBehind() noexcept
+	{
+		// in batches, as for MemoryMappedFile
+		constexpr uint64_t releaseBatchBytes { uint64_t { 1 } << 20 };
+		if (_position < _releaseBehindBytes + releaseBatchBytes || _position - _releaseBehindBytes < _releasedOffset + releaseBatchBytes)
+			return;
+
+		const uint64_t releaseEnd = (_position - _releaseBehindBytes) / PageSize() * PageSize();
+		_window.Release(_releasedOffset, releaseEnd - _releasedOffset);
+		_releasedOffset = releaseEnd;
+	}
+
+	template<CacheHint ch>
+	bool WindowedMappedFile<ch>::MoveWindow()
+	{
+		if (_position >= GetWindowOffset() && _position < GetWindowOffset() + _window.GetMappedBytes())
+			return true;
+
+		const uint64_t offset = _position / PageSize() * PageSize();
+		if (_prefetchThread.joinable())
+		{
+			WaitNext();
+			if (_next.IsValid() && _next.GetMappedOffset() == offset)
+			{
+				std::swap(_window, _next);
+				RequestNext();
+				return true;
+			}
+		}
+
+		if (!_window.ReMap(offset, _windowBytes))
+			return false;
+		if (_prefetchThread.joinable())
+			RequestNext();
+		return true;
+	}
+
+	template<CacheHint ch>
+	void WindowedMappedFile<ch>::RequestNext()
+	{
+		const uint64_t nextOffset = GetWindowOffset() + _window.GetMappedBytes();
+		if (nextOffset >= size())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_nextOffset = nextOffset;
+			_nextRequested = true;
+		}
+		_cv.notify_all();
+	}
+
+	template<CacheHint ch>
+	void WindowedMappedFile<ch>::WaitNext()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_cv.wait(lock, [this]() { return !_nextRequested; });
+	}
+
+	template<CacheHint ch>
+	void WindowedMappedFile<ch>::PrefetchLoop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true)
+		{
+			_cv.wait(lock, [this]() { return _stop || _nextRequested; });
+			if (_stop)
+				return;
+
+			// the scanning thread doesn't touch _next until _nextRequested is reset
+			const uint64_t offset = _nextOffset;
+			lock.unlock();
+			// on failure, _next is left unmapped and the scanning thread maps the window itself
+			if ((_next.IsValid() && _next.GetMappedOffset() == offset) || _next.ReMap(offset, _windowBytes))
+				_next.Prefetch(0, _next.GetMappedBytes());
+			lock.lock();
+
+			_nextRequested = false;
+			_cv.notify_all();
+		}
+	}
+}	 // namespace mm
@@ -0,0 +1,657 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <Crc32.h>
+#include <Enumerators.h>
+#include <Parallel.h>
+#include <RandomAccessFile.h>
+#include <zlib.h>
+
+namespace npypp
+{
+	struct CompressionOptions
+	{
+		CompressionMethod method = CompressionMethod::Deflate;
+		int level = Z_DEFAULT_COMPRESSION;	  ///< 0 (fastest) to 9 (smallest), default is 6
+		CompressionStrategy strategy = CompressionStrategy::Default;
+
+		/// deflate members on more than one thread (0 uses all hardware threads), the output is still a single deflate stream
+		size_t nThreads = 1;
+		/// uncompressed size of the blocks compressed independently when nThreads != 1
+		size_t blockBytes = 1u << 20;
+
+		/**
+		 * Deflated members: full flush every fullFlushBytes uncompressed bytes, so that blocks don't refer to each other and can be
+		 * inflated independently, e.g. on many threads or from a range of rows, and record where they start in an extra field of the
+		 * central directory. The member is still a single deflate stream for other readers. 0 disables it
+		 */
+		size_t fullFlushBytes = 0;
+
+		/// write zip64 records even if sizes and offsets fit in 32 bits, they're used automatically otherwise
+		bool forceZip64 = false;
+
+		/**
+		 * Stored members only: pad the local header with an extra field, as Android's zipalign does, so that the array data starts at a
+		 * multiple of alignment bytes (e.g. 64 for SIMD loads, or the page size), for zero-copy views of mapped archives. 0 disables it
+		 */
+		size_t alignment = 0;
+	};
+
+	namespace detail
+	{
+		static inline int ToZlibStrategy(const CompressionStrategy strategy)
+		{
+			switch (strategy)
+			{
+				case CompressionStrategy::Filtered:
+					return Z_FILTERED;
+				case CompressionStrategy::HuffmanOnly:
+					return Z_HUFFMAN_ONLY;
+				case CompressionStrategy::Rle:
+					return Z_RLE;
+				case CompressionStrategy::Fixed:
+					return Z_FIXED;
+				case CompressionStrategy::Default:
+				default:
+					return Z_DEFAULT_STRATEGY;
+			}
+		}
+
+		static inline uint16_t ToZipCompressionMethod(const CompressionMethod method) { return method == CompressionMethod::Deflate ? 8 : 0; }
+
+		/// throws std::runtime_error on short writes (e.g. disk full), rather than leaving CRCs and sizes describing data that isn't there
+		static inline void WriteBytes(FILE* fp, const void* data, const size_t nBytes)
+		{
+			if (fwrite(data, sizeof(char), nBytes, fp) != nBytes)
+				throw std::runtime_error("cannot write npz member");
+		}
+
+		/**
+		 * pigz-style deflate: the input is cut in blocks which are compressed on worker threads, each one primed with the last 32KB of the
+		 * previous block as dictionary. Blocks end with a sync flush (the last one with Z_FINISH), so that their concatenation is a single
+		 * valid deflate stream, and their CRCs are merged with crc32_combine.
+		 * With CompressionOptions::fullFlushBytes, blocks are that long and have no dictionary: they're independently decodable
+		 */
+		class ParallelDeflater
+		{
+		public:
+			ParallelDeflater(FILE* fp, const CompressionOptions& options);
+
+			void Write(const unsigned char* data, size_t nBytes);
+			void Finish();
+
+			[[nodiscard]] uint32_t GetCrc() const noexcept { return _crc; }
+			[[nodiscard]] uint64_t GetCompressedBytes() const noexcept { return _compressedBytes; }
+			/// compressed offsets of the blocks after the first, if they're independent
+			[[nodiscard]] const std::vector<uint64_t>& GetBlockOffsets() const noexcept { return _blockOffsets; }
+
+		private:
+			static constexpr size_t windowBytes { 1u << 15 };
+
+			struct Block
+			{
+				/// either points to the caller's buffer, or to ownedData
+				const unsigned char* data = nullptr;
+				size_t size = 0;
+				std::vector<unsigned char> ownedData {};
+				std::vector<unsigned char> dictionary {};
+
+				std::vector<unsigned char> compressedData {};
+				uint32_t crc = 0;
+			};
+
+			void AddBlock(const unsigned char* data, size_t size, std::vector<unsigned char>&& ownedData = {});
+
+			/// compress the blocks added so far and write them in order
+			void CompressBlocks(bool finish);
+			void CompressBlock(Block& block, bool last) const;
+
+			FILE* _fp = nullptr;
+			CompressionOptions _options {};
+			size_t _blockBytes = 0;
+			size_t _nBlocksPerBatch = 0;
+
+			std::vector<Block> _blocks {};
+			std::vector<unsigned char> _pendingData {};
+			/// last 32KB of the uncompressed stream, used as dictionary of the next block
+			std::vector<unsigned char> _window {};
+
+			uint32_t _crc = 0;
+			uint64_t _compressedBytes = 0;
+			std::vector<uint64_t> _blockOffsets {};
+		};
+
+		inline ParallelDeflater::ParallelDeflater(FILE* fp, const CompressionOptions& options)
+			: _fp(fp), _options(options), _blockBytes(options.fullFlushBytes > 0 ? options.fullFlushBytes : options.blockBytes)
+		{
+			assert((_options.fullFlushBytes > 0 || _blockBytes >= 2 * windowBytes) && _blockBytes <= std::numeric_limits<uInt>::max());
+			// a few blocks per thread keep them busy while the output is written
+			_nBlocksPerBatch = 4 * GetNumberOfThreads(_options.nThreads);
+			_crc = 0;
+		}
+
+		inline void ParallelDeflater::Write(const unsigned char* data, size_t nBytes)
+		{
+			bool referencesCallerData = false;
+			while (nBytes > 0)
+			{
+				if (_pendingData.empty() && nBytes >= _blockBytes)
+				{
+					// full blocks are compressed straight from the caller's buffer
+					AddBlock(data, _blockBytes);
+					referencesCallerData = true;
+					data += _blockBytes;
+					nBytes -= _blockBytes;
+				}
+				else
+				{
+					const size_t bytesToCopy = std::min(nBytes, _blockBytes - _pendingData.size());
+					_pendingData.insert(_pendingData.end(), data, data + bytesToCopy);
+					data += bytesToCopy;
+					nBytes -= bytesToCopy;
+
+					if (_pendingData.size() == _blockBytes)
+					{
+						const auto* pendingData = _pendingData.data();
+						AddBlock(pendingData, _pendingData.size(), std::move(_pendingData));
+						_pendingData = {};
+					}
+				}
+
+				if (_blocks.size() == _nBlocksPerBatch)
+				{
+					CompressBlocks(false);
+					referencesCallerData = false;
+				}
+			}
+
+			// the caller's buffer is not guaranteed to outlive this call
+			if (referencesCallerData)
+				CompressBlocks(false);
+		}
+
+		inline void ParallelDeflater::Finish()
+		{
+			// the last block is always added, even if empty, as it carries the end of stream marker
+			const auto* pendingData = _pendingData.data();
+			AddBlock(pendingData, _pendingData.size(), std::move(_pendingData));
+			_pendingData = {};
+			CompressBlocks(true);
+		}
+
+		inline void ParallelDeflater::AddBlock(const unsigned char* data, const size_t size, std::vector<unsigned char>&& ownedData)
+		{
+			Block block;
+			block.data = data;
+			block.size = size;
+			block.ownedData = std::move(ownedData);	   // moving a vector doesn't invalidate pointers to its data
+			if (_options.fullFlushBytes == 0)
+				block.dictionary = _window;
+
+			if (size >= windowBytes)
+				_window.assign(data + size - windowBytes, data + size);
+			else
+			{
+				_window.insert(_window.end(), data, data + size);
+				if (_window.size() > windowBytes)
+					_window.erase(_window.begin(), _window.end() - static_cast<std::ptrdiff_t>(windowBytes));
+			}
+
+			_blocks.push_back(std::move(block));
+		}
+
+		inline void ParallelDeflater::CompressBlocks(const bool finish)
+		{
+			ParallelFor(_blocks.size(), _options.nThreads, [&](const size_t i) { CompressBlock(_blocks[i], finish && i == _blocks.size() - 1); });
+
+			for (const auto& block : _blocks)
+			{
+				WriteBytes(_fp, block.compressedData.data(), block.compressedData.size());
+
+				_compressedBytes += block.compressedData.size();
+				_crc = Crc32Combine(_crc, block.crc, block.size);
+				if (_options.fullFlushBytes > 0 && !(finish && &block == &_blocks.back()))
+					_blockOffsets.push_back(_compressedBytes);
+			}
+			_blocks.clear();
+		}
+
+		inline void ParallelDeflater::CompressBlock(Block& block, const bool last) const
+		{
+			block.crc = Crc32(0, block.data, block.size);
+
+			z_stream stream {};
+			[[maybe_unused]] int ret = deflateInit2(&stream, _options.level, Z_DEFLATED, -MAX_WBITS, 8, ToZlibStrategy(_options.strategy));
+			assert(ret == Z_OK);
+			if (!block.dictionary.empty())
+			{
+				ret = deflateSetDictionary(&stream, block.dictionary.data(), static_cast<uInt>(block.dictionary.size()));
+				assert(ret == Z_OK);
+			}
+
+			// a sync flush adds an empty stored block on top of the bound
+			constexpr size_t syncFlushBytes { 16 };
+			block.compressedData.resize(deflateBound(&stream, static_cast<uLong>(block.size)) + syncFlushBytes);
+
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast): zlib doesn't modify the input
+			stream.next_in = const_cast<Bytef*>(block.data);
+			stream.avail_in = static_cast<uInt>(block.size);
+			stream.next_out = block.compressedData.data();
+			stream.avail_out = static_cast<uInt>(block.compressedData.size());
+			ret = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+			assert(ret == (last ? Z_STREAM_END : Z_OK) && stream.avail_in == 0 && stream.avail_out > 0);
+
+			block.compressedData.resize(stream.total_out);
+			deflateEnd(&stream);
+		}
+
+		/**
+		 * Writes the payload of a single zip member, either stored or deflated, keeping track of its CRC and sizes.
+		 * Input is streamed through a fixed size output buffer, so no compressed copy of the member is held in memory
+		 */
+		class MemberWriter
+		{
+		public:
+			MemberWriter(FILE* fp, const CompressionOptions& options);
+			~MemberWriter() noexcept;
+
+			MemberWriter(const MemberWriter&) = delete;
+			MemberWriter(MemberWriter&&) = delete;
+			MemberWriter& operator=(const MemberWriter&) = delete;
+			MemberWriter& operator=(MemberWriter&&) = delete;
+
+			void Write(const void* data, size_t nBytes);
+
+			/// flush the compressed stream, no more writes are allowed afterwards
+			void Finish();
+
+			[[nodiscard]] uint32_t GetCrc() const noexcept { return _crc; }
+			[[nodiscard]] uint64_t GetCompressedBytes() const noexcept { return _compressedBytes; }
+			[[nodiscard]] uint64_t GetUncompressedBytes() const noexcept { return _uncompressedBytes; }
+
+			/// independently decodable blocks (see CompressionOptions::fullFlushBytes): uncompressed size, and compressed offsets of the blocks after the first
+			[[nodiscard]] uint64_t GetBlockBytes() const noexcept { return _options.method == CompressionMethod::Deflate ? _options.fullFlushBytes : 0; }
+			[[nodiscard]] const std::vector<uint64_t>& GetBlockOffsets() const noexcept { return _blockOffsets; }
+
+		private:
+			/// zlib counters are 32 bits wide, so data is fed in chunks no larger than this
+			static constexpr size_t maxChunkBytes { 1u << 30 };
+			static constexpr size_t outBufferBytes { 1u << 18 };
+
+			void Deflate(int flush);
+
+			FILE* _fp = nullptr;
+			CompressionOptions _options {};
+			std::unique_ptr<ParallelDeflater> _parallelDeflater {};
+			z_stream _stream {};
+			std::vector<unsigned char> _outBuffer {};
+			bool _finished = false;
+
+			uint32_t _crc = 0;
+			uint64_t _compressedBytes = 0;
+			uint64_t _uncompressedBytes = 0;
+			std::vector<uint64_t> _blockOffsets {};
+		};
+
+		inline MemberWriter::MemberWriter(FILE* fp, const CompressionOptions& options) : _fp(fp), _options(options)
+		{
+			assert(_fp != nullptr);
+			_crc = 0;
+
+			if (_options.method == CompressionMethod::Deflate && _options.nThreads != 1)
+				_parallelDeflater = std::make_unique<ParallelDeflater>(_fp, _options);
+			else if (_options.method == CompressionMethod::Deflate)
+			{
+				_outBuffer.resize(outBufferBytes);
+				// negative window bits: raw deflate stream, as zip members don't have the zlib header
+				[[maybe_unused]] const int ret = deflateInit2(&_stream, _options.level, Z_DEFLATED, -MAX_WBITS, 8, ToZlibStrategy(_options.strategy));
+				assert(ret == Z_OK);
+			}
+		}
+
+		inline MemberWriter::~MemberWriter() noexcept
+		{
+			if (_options.method == CompressionMethod::Deflate && !_parallelDeflater)
+				deflateEnd(&_stream);
+		}
+
+		inline void MemberWriter::Write(const void* data, size_t nBytes)
+		{
+			assert(!_finished);
+			const auto* buffer = static_cast<const unsigned char*>(data);
+			if (_parallelDeflater)
+			{
+				// CRC is computed block by block on the worker threads
+				_parallelDeflater->Write(buffer, nBytes);
+				_uncompressedBytes += nBytes;
+				return;
+			}
+
+			const uint64_t blockBytes = GetBlockBytes();
+			while (nBytes > 0)
+			{
+				// chunks end at the flush points
+				size_t chunkBytes = std::min(nBytes, maxChunkBytes);
+				if (blockBytes > 0)
+					chunkBytes = static_cast<size_t>(std::min<uint64_t>(chunkBytes, blockBytes - _uncompressedBytes % blockBytes));
+				_crc = ParallelCrc32(_crc, buffer, chunkBytes, _options.nThreads);
+				_uncompressedBytes += chunkBytes;
+
+				if (_options.method == CompressionMethod::Deflate)
+				{
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast): zlib doesn't modify the input
+					_stream.next_in = const_cast<Bytef*>(buffer);
+					_stream.avail_in = static_cast<uInt>(chunkBytes);
+					Deflate(Z_NO_FLUSH);
+
+					// a full flush byte-aligns the output, and resets the window: what follows doesn't refer to what came before
+					if (blockBytes > 0 && _uncompressedBytes % blockBytes == 0)
+					{
+						Deflate(Z_FULL_FLUSH);
+						_blockOffsets.push_back(_compressedBytes);
+					}
+				}
+				else
+				{
+					WriteBytes(_fp, buffer, chunkBytes);
+					_compressedBytes += chunkBytes;
+				}
+
+				buffer += chunkBytes;
+				nBytes -= chunkBytes;
+			}
+		}
+
+		inline void MemberWriter::Finish()
+		{
+			assert(!_finished);
+			if (_parallelDeflater)
+			{
+				_parallelDeflater->Finish();
+				_crc = _parallelDeflater->GetCrc();
+				_compressedBytes = _parallelDeflater->GetCompressedBytes();
+				_blockOffsets = _parallelDeflater->GetBlockOffsets();
+			}
+			else if (_options.method == CompressionMethod::Deflate)
+				Deflate(Z_FINISH);
+			_finished = true;
+
+			// a flush point at the very end starts an empty block
+			while (!_blockOffsets.empty() && _blockOffsets.size() * GetBlockBytes() >= _uncompressedBytes)
+				_blockOffsets.pop_back();
+		}
+
+		inline void MemberWriter::Deflate(const int flush)
+		{
+			int ret = Z_OK;
+			do
+			{
+				_stream.next_out = _outBuffer.data();
+				_stream.avail_out = static_cast<uInt>(_outBuffer.size());
+				ret = deflate(&_stream, flush);
+				assert(ret != Z_STREAM_ERROR);
+
+				const size_t compressedBytes = _outBuffer.size() - _stream.avail_out;
+				WriteBytes(_fp, _outBuffer.data(), compressedBytes);
+				_compressedBytes += compressedBytes;
+			} while (_stream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+		}
+
+		/// state needed to resume inflating a deflate stream at a block boundary, as in zlib's zran example
+		struct InflateCheckpoint
+		{
+			uint64_t compressedOffset = 0;	  ///< compressed bytes consumed, the last one possibly only in part (see bits)
+			uint64_t uncompressedOffset = 0;
+			int bits = 0;	 ///< bits of the last consumed byte which belong to the next block
+			std::vector<unsigned char> window {};	 ///< the last (up to) 32KB inflated, which the next blocks can refer to
+		};
+
+		/**
+		 * Inflates the payload of a deflated zip member incrementally, into buffers provided by the caller.
+		 * Compressed bytes are read through a small fixed size buffer (or straight from memory, e.g. a mapping),
+		 * so that neither the compressed nor the uncompressed member needs to be held in memory in full
+		 */
+		class MemberReader
+		{
+		public:
+			MemberReader(const RandomAccessFile& file, uint64_t offset, uint64_t compressedBytes, bool computeCrc = false);
+			MemberReader(const unsigned char* data, uint64_t compressedBytes, bool computeCrc = false);
+			/// resume inflating the member at offset from a checkpoint of its index
+			MemberReader(const RandomAccessFile& file, uint64_t offset, uint64_t compressedBytes, const InflateCheckpoint& checkpoint, bool computeCrc = false);
+			~MemberReader() noexcept { inflateEnd(&_stream); }
+
+			MemberReader(const MemberReader&) = delete;
+			MemberReader(MemberReader&&) = delete;
+			MemberReader& operator=(const MemberReader&) = delete;
+			MemberReader& operator=(MemberReader&&) = delete;
+
+			/// inflate exactly nBytes into out, throws std::runtime_error if the stream is corrupt or shorter
+			void Read(void* out, uint64_t nBytes);
+
+			/// inflate and discard nBytes
+			void Skip(uint64_t nBytes);
+
+			/// check that the deflate stream ends right after the bytes read so far
+			void Finish();
+
+			/**
+			 * Inflate the whole stream, from its start, and return checkpoints at the first block boundaries after every checkpointBytes
+			 * uncompressed bytes. Resuming from them (see the constructor) doesn't need what comes before, at the cost of a 32KB window each
+			 */
+			[[nodiscard]] std::vector<InflateCheckpoint> Index(uint64_t checkpointBytes);
+
+			/// CRC of the bytes inflated so far, if computeCrc
+			[[nodiscard]] uint32_t GetCrc() const noexcept { return _crc; }
+
+		private:
+			/// zlib counters are 32 bits wide, so data is fed in chunks no larger than this
+			static constexpr size_t maxChunkBytes { 1u << 30 };
+			static constexpr size_t inBufferBytes { 1u << 18 };
+			/// deflate's maximum back-reference distance
+			static constexpr size_t windowBytes { 1u << 15 };
+
+			void Init();
+			void Refill();
+			int Inflate(unsigned char* out, size_t nBytes, int flush = Z_NO_FLUSH);
+
+			const RandomAccessFile* _file = nullptr;
+			const unsigned char* _data = nullptr;	 ///< position of the next compressed bytes, when inflating from memory
+			uint64_t _offset = 0;					 ///< position of the next compressed bytes, when inflating from a file
+			uint64_t _compressedBytes = 0;
+			uint64_t _remainingIn = 0;
+			std::vector<unsigned char> _inBuffer {};
+			z_stream _stream {};
+			bool _ended = false;
+
+			bool _computeCrc = false;
+			uint32_t _crc = 0;
+		};
+
+		inline MemberReader::MemberReader(const RandomAccessFile& file, const uint64_t offset, const uint64_t compressedBytes, const bool computeCrc)
+			: _file(&file), _offset(offset), _compressedBytes(compressedBytes), _remainingIn(compressedBytes), _inBuffer(std::min<uint64_t>(compressedBytes, inBufferBytes)), _computeCrc(computeCrc)
+		{
+			Init();
+		}
+
+		inline MemberReader::MemberReader(const unsigned char* data, const uint64_t compressedBytes, const bool computeCrc)
+			: _data(data), _compressedBytes(compressedBytes), _remainingIn(compressedBytes), _computeCrc(computeCrc)
+		{
+			Init();
+		}
+
+		inline MemberReader::MemberReader(const RandomAccessFile& file, const uint64_t offset, const uint64_t compressedBytes, const InflateCheckpoint& checkpoint, const bool computeCrc)
+			: _file(&file),
+			  _offset(offset + checkpoint.compressedOffset),
+			  _compressedBytes(compressedBytes),
+			  _remainingIn(compressedBytes - checkpoint.compressedOffset),
+			  _inBuffer(std::min<uint64_t>(_remainingIn, inBufferBytes)),
+			  _computeCrc(computeCrc)
+		{
+			// a block starting within the last consumed byte needs one to have been consumed
+			if (checkpoint.compressedOffset > compressedBytes || checkpoint.bits < 0 || checkpoint.bits > 7 || (checkpoint.bits > 0 && checkpoint.compressedOffset == 0)
+				|| checkpoint.window.size() > windowBytes)
+				throw std::runtime_error("invalid inflate checkpoint");
+			Init();
+
+			// the destructor doesn't run if the constructor throws
+			const auto fail = [this](const char* message)
+			{
+				inflateEnd(&_stream);
+				throw std::runtime_error(message);
+			};
+
+			// the next block starts within the last consumed byte
+			if (checkpoint.bits > 0)
+			{
+				unsigned char lastByte = 0;
+				if (!file.ReadAt(&lastByte, 1, _offset - 1))
+					fail("cannot read compressed member");
+				if (inflatePrime(&_stream, checkpoint.bits, lastByte >> (8 - checkpoint.bits)) != Z_OK)
+					fail("invalid inflate checkpoint");
+			}
+			if (!checkpoint.window.empty() && inflateSetDictionary(&_stream, checkpoint.window.data(), static_cast<uInt>(checkpoint.window.size())) != Z_OK)
+				fail("invalid inflate checkpoint");
+		}
+
+		inline void MemberReader::Init()
+		{
+			// negative window bits: raw deflate stream, as zip members don't have the zlib header
+			if (inflateInit2(&_stream, -MAX_WBITS) != Z_OK)
+				throw std::runtime_error("cannot initialize zlib");
+		}
+
+		inline void MemberReader::Refill()
+		{
+			if (_file == nullptr)
+			{
+				const auto chunkBytes = static_cast<size_t>(std::min<uint64_t>(_remainingIn, maxChunkBytes));
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast): zlib doesn't modify the input
+				_stream.next_in = const_cast<Bytef*>(_data);
+				_stream.avail_in = static_cast<uInt>(chunkBytes);
+				_data += chunkBytes;
+				_remainingIn -= chunkBytes;
+				return;
+			}
+
+			const auto chunkBytes = static_cast<size_t>(std::min<uint64_t>(_remainingIn, _inBuffer.size()));
+			if (!_file->ReadAt(_inBuffer.data(), chunkBytes, _offset))
+				throw std::runtime_error("cannot read compressed member");
+			_stream.next_in = _inBuffer.data();
+			_stream.avail_in = static_cast<uInt>(chunkBytes);
+			_offset += chunkBytes;
+			_remainingIn -= chunkBytes;
+		}
+
+		inline int MemberReader::Inflate(unsigned char* out, const size_t nBytes, const int flush)
+		{
+			if (_stream.avail_in == 0)
+				Refill();
+
+			_stream.next_out = out;
+			_stream.avail_out = static_cast<uInt>(nBytes);
+			const int ret = inflate(&_stream, flush);
+			// Z_BUF_ERROR: no progress possible, i.e. the compressed bytes ran out
+			if (ret != Z_OK && ret != Z_STREAM_END)
+				throw std::runtime_error(ret == Z_BUF_ERROR ? "truncated deflate stream" : "corrupt deflate stream");
+
+			_ended = ret == Z_STREAM_END;
+			return ret;
+		}
+
+		inline void MemberReader::Read(void* out, uint64_t nBytes)
+		{
+			auto* buffer = static_cast<unsigned char*>(out);
+			while (nBytes > 0)
+			{
+				if (_ended)
+					throw std::runtime_error("deflate stream shorter than the member size");
+
+				const auto chunkBytes = static_cast<size_t>(std::min<uint64_t>(nBytes, maxChunkBytes));
+				Inflate(buffer, chunkBytes);
+				const size_t inflatedBytes = chunkBytes - _stream.avail_out;
+
+				// checksum while the inflated bytes are still in cache
+				if (_computeCrc)
+					_crc = Crc32(_crc, buffer, inflatedBytes);
+
+				buffer += inflatedBytes;
+				nBytes -= inflatedBytes;
+			}
+		}
+
+		inline void MemberReader::Skip(uint64_t nBytes)
+		{
+			std::vector<unsigned char> buffer(static_cast<size_t>(std::min<uint64_t>(nBytes, inBufferBytes)));
+			while (nBytes > 0)
+			{
+				const auto chunkBytes = std::min<uint64_t>(nBytes, buffer.size());
+				Read(buffer.data(), chunkBytes);
+				nBytes -= chunkBytes;
+			}
+		}
+
+		inline std::vector<InflateCheckpoint> MemberReader::Index(const uint64_t checkpointBytes)
+		{
+			assert(checkpointBytes > 0 && _remainingIn + _stream.avail_in == _compressedBytes);
+
+			// circular buffer of the last inflated bytes
+			std::vector<unsigned char> window(windowBytes);
+			std::vector<InflateCheckpoint> checkpoints;
+			uint64_t inflatedBytes = 0;
+			uint64_t lastCheckpoint = 0;
+			while (!_ended)
+			{
+				// Z_BLOCK returns at the end of each deflate block
+				const auto position = static_cast<size_t>(inflatedBytes % windowBytes);
+				Inflate(window.data() + position, windowBytes - position, Z_BLOCK);
+				const size_t newBytes = windowBytes - position - _stream.avail_out;
+				if (_computeCrc)
+					_crc = Crc32(_crc, window.data() + position, newBytes);
+				inflatedBytes += newBytes;
+
+				// bit 7: right after the end of a block, bit 6: in the last block, which has nothing after it
+				const bool isBlockBoundary = (_stream.data_type & 128) != 0 && (_stream.data_type & 64) == 0;
+				if (!isBlockBoundary || inflatedBytes - lastCheckpoint < checkpointBytes)
+					continue;
+
+				InflateCheckpoint checkpoint;
+				checkpoint.compressedOffset = _compressedBytes - _remainingIn - _stream.avail_in;
+				checkpoint.uncompressedOffset = inflatedBytes;
+				checkpoint.bits = _stream.data_type & 7;
+				if (inflatedBytes < windowBytes)
+					checkpoint.window.assign(window.begin(), window.begin() + static_cast<std::ptrdiff_t>(inflatedBytes));
+				else
+				{
+					// the oldest bytes come right after the newest ones
+					const auto end = window.begin() + static_cast<std::ptrdiff_t>(inflatedBytes % windowBytes);
+					checkpoint.window.assign(end, window.end());
+					checkpoint.window.insert(checkpoint.window.end(), window.begin(), end);
+				}
+				checkpoints.push_back(std::move(checkpoint));
+				lastCheckpoint = inflatedBytes;
+			}
+
+			return checkpoints;
+		}
+
+		inline void MemberReader::Finish()
+		{
+			// the end of block marker may still be pending once the last byte has been inflated
+			unsigned char extraByte = 0;
+			while (!_ended)
+			{
+				Inflate(&extraByte, 1);
+				if (_stream.avail_out == 0)
+					throw std::runtime_error("deflate stream longer than the member size");
+			}
+		}
+	}	 // namespace detail
+}	 // namespace npypp
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <Parallel.h>
+#include <zlib.h>
+
+#if defined(__x86_64__) && !defined(_MSC_VER)
+	#define NPYPP_CRC32_PCLMUL
+	#include <immintrin.h>
+#endif
+
+namespace npypp
+{
+	namespace detail
+	{
+#ifdef NPYPP_CRC32_PCLMUL
+		/// fold 128 bits of x onto y with the constants in k
+		__attribute__((target("pclmul,sse4.1"))) static inline __m128i Crc32Fold(const __m128i x, const __m128i k, const __m128i y) noexcept
+		{
+			return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00)), y);
+		}
+
+		/**
+		 * CRC32 (zip polynomial) by folding 64 bytes at a time with carry-less multiplications, see Intel's
+		 * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction". Constants are for the bit-reflected domain.
+		 * Requires nBytes >= 64 and a multiple of 16; crc is the raw register, i.e. not pre/post inverted
+		 */
+		__attribute__((target("pclmul,sse4.1"))) static inline uint32_t Crc32Pclmul(const unsigned char* buffer, size_t nBytes, const uint32_t crc) noexcept
+		{
+			alignas(16) static constexpr std::array<uint64_t, 2> k1k2 { 0x0154442bd4, 0x01c6e41596 };
+			alignas(16) static constexpr std::array<uint64_t, 2> k3k4 { 0x01751997d0, 0x00ccaa009e };
+			alignas(16) static constexpr std::array<uint64_t, 2> k5k0 { 0x0163cd6124, 0x0000000000 };
+			alignas(16) static constexpr std::array<uint64_t, 2> poly { 0x01db710641, 0x01f7011641 };
+
+			// NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+			const auto load = [](const unsigned char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); };
+			const auto loadConstant = [](const std::array<uint64_t, 2>& k) { return _mm_load_si128(reinterpret_cast<const __m128i*>(k.data())); };
+			// NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+
+			// fold 4 x 128 bits in parallel
+			__m128i x1 = _mm_xor_si128(load(buffer), _mm_cvtsi32_si128(static_cast<int>(crc)));
+			__m128i x2 = load(buffer + 16);
+			__m128i x3 = load(buffer + 32);
+			__m128i x4 = load(buffer + 48);
+			buffer += 64;
+			nBytes -= 64;
+
+			__m128i k = loadConstant(k1k2);
+			for (; nBytes >= 64; buffer += 64, nBytes -= 64)
+			{
+				x1 = Crc32Fold(x1, k, load(buffer));
+				x2 = Crc32Fold(x2, k, load(buffer + 16));
+				x3 = Crc32Fold(x3, k, load(buffer + 32));
+				x4 = Crc32Fold(x4, k, load(buffer + 48));
+			}
+
+			// fold into 128 bits
+			k = loadConstant(k3k4);
+			x1 = Crc32Fold(x1, k, x2);
+			x1 = Crc32Fold(x1, k, x3);
+			x1 = Crc32Fold(x1, k, x4);
+			for (; nBytes >= 16; buffer += 16, nBytes -= 16)
+				x1 = Crc32Fold(x1, k, load(buffer));
+
+			// fold 128 bits into 64 bits
+			const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+			x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+			k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0.data()));	   // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+			x2 = _mm_srli_si128(x1, 4);
+			x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00), x2);
+
+			// Barrett reduction to 32 bits
+			k = loadConstant(poly);
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10);
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), k, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+
+			return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+		}
+
+		static inline bool HasPclmul() noexcept
+		{
+			static const bool hasPclmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+			return hasPclmul;
+		}
+#endif
+
+		/// zlib's crc32 takes 32 bits lengths
+		static inline uint32_t Crc32Zlib(uint32_t crc, const unsigned char* buffer, uint64_t nBytes) noexcept
+		{
+			constexpr uint64_t maxChunkBytes { 1u << 30 };
+			while (nBytes > 0)
+			{
+				const auto chunkBytes = std::min(nBytes, maxChunkBytes);
+				crc = static_cast<uint32_t>(crc32(crc, buffer, static_cast<uInt>(chunkBytes)));
+				buffer += chunkBytes;
+				nBytes -= chunkBytes;
+			}
+			return crc;
+		}
+
+		/// CRC32 of the zip format, continuing from crc (0 for a new checksum), using carry-less multiplications when available
+		static inline uint32_t Crc32(uint32_t crc, const void* data, uint64_t nBytes) noexcept
+		{
+			const auto* buffer = static_cast<const unsigned char*>(data);
+#ifdef NPYPP_CRC32_PCLMUL
+			constexpr uint64_t minPclmulBytes { 64 };
+			if (nBytes >= minPclmulBytes && HasPclmul())
+			{
+				const uint64_t foldedBytes = nBytes & ~uint64_t { 15 };
+				crc = ~Crc32Pclmul(buffer, static_cast<size_t>(foldedBytes), ~crc);
+				buffer += foldedBytes;
+				nBytes -= foldedBytes;
+			}
+#endif
+			return Crc32Zlib(crc, buffer, nBytes);
+		}
+
+		/// CRC32 of the concatenation of two buffers, given their CRCs and the size of the second one
+		static inline uint32_t Crc32Combine(const uint32_t crc1, const uint32_t crc2, const uint64_t nBytes2) noexcept
+		{
+			return static_cast<uint32_t>(crc32_combine(crc1, crc2, static_cast<z_off_t>(nBytes2)));
+		}
+
+		/**
+		 * Split large buffers across threads (0 uses all hardware threads), and merge the partial CRCs with crc32_combine.
+		 * Buffers smaller than minBytesPerThread per thread are not worth the thread start-up
+		 */
+		static inline uint32_t ParallelCrc32(const uint32_t crc, const void* data, const uint64_t nBytes, const size_t nThreads = 0, const uint64_t minBytesPerThread = 1u << 24)
+		{
+			const size_t nChunks = static_cast<size_t>(std::min<uint64_t>(GetNumberOfThreads(nThreads), std::max<uint64_t>(1, nBytes / minBytesPerThread)));
+			if (nChunks <= 1)
+				return Crc32(crc, data, nBytes);
+
+			const auto* buffer = static_cast<const unsigned char*>(data);
+			const uint64_t chunkBytes = (nBytes + nChunks - 1) / nChunks;
+			const auto getChunkBytes = [&](const size_t i) { return std::min(chunkBytes, nBytes - i * chunkBytes); };
+
+			std::vector<uint32_t> chunkCrcs(nChunks);
+			ParallelFor(nChunks, nChunks, [&](const size_t i) { chunkCrcs[i] = Crc32(0, buffer + i * chunkBytes, getChunkBytes(i)); });
+
+			uint32_t ret = crc;
+			for (size_t i = 0; i < nChunks; ++i)
+				ret = Crc32Combine(ret, chunkCrcs[i], getChunkBytes(i));
+			return ret;
+		}
+	}	 // namespace detail
+}	 // namespace npypp
@@ -21,3 +21,23 @@ static const char* ToString(const FileOpenMode mode)
 			return "?";
 	}
 }
+
+namespace npypp
+{
+	/// how each member of an *.npz file is stored (zip compression methods 0 and 8)
+	enum class CompressionMethod
+	{
+		Stored,	   ///< equivalent to numpy.savez
+		Deflate	   ///< equivalent to numpy.savez_compressed
+	};
+
+	/// maps onto zlib's deflate strategies
+	enum class CompressionStrategy
+	{
+		Default,
+		Filtered,	   ///< data produced by a filter, i.e. small values with a somewhat random distribution
+		HuffmanOnly,   ///< no string matching
+		Rle,		   ///< match distances of one, fast on long runs of the same value (e.g. sparse arrays)
+		Fixed		   ///< no dynamic Huffman codes
+	};
+}	 // namespace npypp
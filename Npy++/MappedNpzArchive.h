@@ -0,0 +1,37 @@
+#pragma once
+
+#include <MappedViews.h>
+#include <NpzArchive.h>
+
+namespace npypp
+{
+	/**
+	 * Memory mapped *.npz file.
+	 * Stored members (numpy.savez, CompressionMethod::Stored) are viewed in place when their data is aligned for T and in the system endianness,
+	 * so that large arrays are served straight from the page cache, and shared across processes, without copies.
+	 * Otherwise (deflated members, misaligned or foreign-endian data) the member is decoded into a copy owned by the returned array.
+	 * Views keep the mapping alive, and viewing members is thread-safe
+	 */
+	template<typename mm::CacheHint ch = mm::CacheHint::RandomAccess>
+	class MappedNpzArchive: public NpzDirectory
+	{
+	public:
+		/// throws std::runtime_error if the file can't be mapped, or isn't a zip archive
+		explicit MappedNpzArchive(const std::string& fileName);
+
+		/// throws std::out_of_range if there's no such member
+		template<typename T>
+		[[nodiscard]] MappedArray<T> View(const std::string& name, const NpzLoadOptions& options = {}) const;
+
+		/// offset in the file of the member's data (i.e. its npy header), right after its local header
+		[[nodiscard]] uint64_t GetDataOffset(const NpzMemberInfo& info) const;
+
+	private:
+		using MemoryMappedFile = mm::MemoryMappedFile<ch, mm::MapMode::ReadOnly>;
+
+		std::string _fileName;
+		MemoryMappedFile _mmf;
+	};
+}	 // namespace npypp
+
+#include <MappedNpzArchive.tpp>
@@ -0,0 +1,98 @@
+#pragma once
+
+namespace npypp
+{
+	template<typename mm::CacheHint ch>
+	MappedNpzArchive<ch>::MappedNpzArchive(const std::string& fileName) : _fileName(fileName), _mmf(fileName)
+	{
+		if (!_mmf.IsValid())
+			throw std::runtime_error("cannot map " + fileName);
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto* file = reinterpret_cast<const char*>(_mmf.GetDataAt(0));
+		uint64_t nRecords = 0;
+		uint64_t globalHeaderSize = 0;
+		uint64_t globalHeaderOffset = 0;
+		detail::ParseNpzFooter(file, _mmf.size(), nRecords, globalHeaderSize, globalHeaderOffset);
+		if (globalHeaderOffset + globalHeaderSize > _mmf.size())
+			throw std::runtime_error("truncated central directory in " + fileName);
+
+		auto entries = detail::ParseCentralDirectory(file + globalHeaderOffset, globalHeaderSize);
+		assert(entries.size() == nRecords);
+		Index(std::move(entries));
+	}
+
+	template<typename mm::CacheHint ch>
+	uint64_t MappedNpzArchive<ch>::GetDataOffset(const NpzMemberInfo& info) const
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto* localHeader = reinterpret_cast<const char*>(_mmf.GetDataAt(0)) + info.localHeaderOffset;
+		if (info.localHeaderOffset + detail::localHeaderSize > _mmf.size() || detail::readBytes<uint32_t>(localHeader) != 0x04034b50)
+			throw std::runtime_error("invalid local header for member '" + info.name + "' of " + _fileName);
+
+		// the local header's extra fields may differ from the central directory ones
+		const auto nameLength = detail::readBytes<uint16_t>(localHeader + 26);
+		const auto extraFieldsLength = detail::readBytes<uint16_t>(localHeader + 28);
+		const uint64_t ret = info.localHeaderOffset + detail::localHeaderSize + nameLength + extraFieldsLength;
+		if (ret + info.compressedBytes > _mmf.size())
+			throw std::runtime_error("truncated member '" + info.name + "' in " + _fileName);
+
+		return ret;
+	}
+
+	template<typename mm::CacheHint ch>
+	template<typename T>
+	MappedArray<T> MappedNpzArchive<ch>::View(const std::string& name, const NpzLoadOptions& options) const
+	{
+		const auto& info = Info(name);
+		const unsigned char* member = _mmf.GetDataAt(0) + GetDataOffset(info);
+
+		uint32_t crc = 0;
+		const auto checkCrc = [&]()
+		{
+			if (options.verifyCrc && crc != info.crc)
+				throw std::runtime_error("CRC mismatch for member '" + name + "' of " + _fileName);
+		};
+
+		if (!info.IsStored())
+		{
+			auto array = detail::InflateMember<T>(member, info.compressedBytes, info.uncompressedBytes, options.verifyCrc ? &crc : nullptr);
+			checkCrc();
+			return MappedArray<T>(std::move(array));
+		}
+
+		std::vector<size_t> shape;
+		size_t wordSize = 0;
+		bool fortranOrder = false;
+		char endianness = 0;
+		const size_t headerBytes = detail::ParseNpyHeader(member, wordSize, shape, fortranOrder, endianness);
+		assert(wordSize == sizeof(T));
+
+		const size_t nElements = std::accumulate(shape.begin(), shape.end(), size_t { 1 }, std::multiplies<>());
+		if (headerBytes + nElements * sizeof(T) > info.uncompressedBytes)
+			throw std::runtime_error("truncated member '" + name + "' in " + _fileName);
+
+		if (options.verifyCrc)
+		{
+			crc = detail::ParallelCrc32(0, member, info.uncompressedBytes);
+			checkCrc();
+		}
+
+		const unsigned char* data = member + headerBytes;
+		const bool swap = endianness != '|' && endianness != detail::SysEndianness();
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const bool aligned = reinterpret_cast<uintptr_t>(data) % alignof(T) == 0;
+		if (aligned && !swap)
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			return MappedArray<T>(reinterpret_cast<const T*>(data), std::move(shape), _mmf.GetRegion(), true);
+
+		MultiDimensionalArray<T> array;
+		array.shape = std::move(shape);
+		array.data.resize(nElements);
+		std::memcpy(array.data.data(), data, nElements * sizeof(T));
+		if (swap)
+			detail::SwapEndianness(array.data);
+
+		return MappedArray<T>(std::move(array));
+	}
+}	 // namespace npypp
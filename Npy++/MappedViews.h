@@ -0,0 +1,181 @@
+#pragma once
+
+#include <Npy++.h>
+
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+namespace npypp
+{
+	/**
+	 * Read-only view over the data of a memory mapped *.npy file.
+	 * Elements are byte-swapped lazily on access when the file endianness differs from the system one, so that
+	 * sampling a few elements of a foreign-endian file doesn't require swapping (nor copying) the whole buffer.
+	 * The mapping is expected to be opened with CacheHint::RandomAccess. The view keeps the mapped region alive, so it may outlive the mapping
+	 */
+	template<typename T, typename mm::CacheHint ch = mm::CacheHint::RandomAccess, typename mm::MapMode mpm = mm::MapMode::ReadOnly>
+	class ByteSwappedView
+	{
+	public:
+		/// random access iterator returning elements by value, as they can't be referenced in place
+		class ConstIterator
+		{
+		public:
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = T;
+
+			ConstIterator() noexcept = default;
+			ConstIterator(const ByteSwappedView* view, const size_t index) noexcept : _view(view), _index(index) {}
+
+			// NOLINTBEGIN(fuchsia-overloaded-operator)
+			T operator*() const noexcept { return (*_view)[_index]; }
+			T operator[](const difference_type n) const noexcept { return (*_view)[Offset(n)]; }
+
+			ConstIterator& operator++() noexcept { ++_index; return *this; }
+			ConstIterator operator++(int) noexcept { auto ret = *this; ++_index; return ret; }
+			ConstIterator& operator--() noexcept { --_index; return *this; }
+			ConstIterator operator--(int) noexcept { auto ret = *this; --_index; return ret; }
+			ConstIterator& operator+=(const difference_type n) noexcept { _index = Offset(n); return *this; }
+			ConstIterator& operator-=(const difference_type n) noexcept { _index = Offset(-n); return *this; }
+			ConstIterator operator+(const difference_type n) const noexcept { return ConstIterator(_view, Offset(n)); }
+			ConstIterator operator-(const difference_type n) const noexcept { return ConstIterator(_view, Offset(-n)); }
+			difference_type operator-(const ConstIterator& rhs) const noexcept { return static_cast<difference_type>(_index) - static_cast<difference_type>(rhs._index); }
+
+			bool operator==(const ConstIterator& rhs) const noexcept { return _index == rhs._index; }
+			bool operator!=(const ConstIterator& rhs) const noexcept { return _index != rhs._index; }
+			bool operator<(const ConstIterator& rhs) const noexcept { return _index < rhs._index; }
+			bool operator>(const ConstIterator& rhs) const noexcept { return _index > rhs._index; }
+			bool operator<=(const ConstIterator& rhs) const noexcept { return _index <= rhs._index; }
+			bool operator>=(const ConstIterator& rhs) const noexcept { return _index >= rhs._index; }
+			// NOLINTEND(fuchsia-overloaded-operator)
+
+		private:
+			[[nodiscard]] size_t Offset(const difference_type n) const noexcept { return static_cast<size_t>(static_cast<difference_type>(_index) + n); }
+
+			const ByteSwappedView* _view = nullptr;
+			size_t _index = 0;
+		};
+
+		/// parses the npy header at the current position of the mapped view, which is left untouched
+		explicit ByteSwappedView(const mm::MemoryMappedFile<ch, mpm>& mmf);
+
+		/// access element, no range checking
+		// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+		T operator[](const size_t i) const noexcept;
+
+		[[nodiscard]] size_t size() const noexcept { return _nElements; }
+		[[nodiscard]] const std::vector<size_t>& GetShape() const noexcept { return _shape; }
+
+		/// true if the file endianness differs from the system one, i.e. elements are swapped on access
+		[[nodiscard]] bool IsSwapped() const noexcept { return _swap; }
+
+		[[nodiscard]] ConstIterator begin() const noexcept { return ConstIterator(this, 0); }
+		[[nodiscard]] ConstIterator end() const noexcept { return ConstIterator(this, _nElements); }
+
+		/// copy the elements at the given indices into out, swapping only the gathered elements
+		void Gather(const size_t* indices, const size_t nIndices, T* out) const noexcept;
+
+		[[nodiscard]] std::vector<T> Gather(const std::vector<size_t>& indices) const
+		{
+			std::vector<T> ret(indices.size());
+			Gather(indices.data(), indices.size(), ret.data());
+			return ret;
+		}
+
+	private:
+		std::shared_ptr<const mm::MappedRegion> _region {};
+		const unsigned char* _data = nullptr;
+		size_t _nElements = 0;
+		std::vector<size_t> _shape {};
+		bool _swap = false;
+	};
+
+	/**
+	 * Array of a *.npy file modified in place in its mapping: with MapMode::CopyOnWrite, only the pages written to are copied, privately,
+	 * while the others are shared with the page cache, and the file is left untouched (with MapMode::ReadAndWrite, writes go to the file).
+	 * Elements are referenced in place, so the data must be in the system endianness and aligned to T (ByteSwappedView reads other files).
+	 * The view keeps the mapped region, and so the modified pages, alive
+	 */
+	template<typename T>
+	class WritableView
+	{
+	public:
+		/// parses the npy header at the current position of the mapped view; throws std::runtime_error if the data can't be referenced in place
+		template<typename mm::CacheHint ch, typename mm::MapMode mpm>
+		explicit WritableView(mm::MemoryMappedFile<ch, mpm>& mmf);
+
+		/// access element, no range checking
+		// NOLINTBEGIN(fuchsia-overloaded-operator)
+		T& operator[](const size_t i) noexcept { return _data[i]; }
+		const T& operator[](const size_t i) const noexcept { return _data[i]; }
+		// NOLINTEND(fuchsia-overloaded-operator)
+
+		[[nodiscard]] T* data() noexcept { return _data; }
+		[[nodiscard]] const T* data() const noexcept { return _data; }
+		[[nodiscard]] size_t size() const noexcept { return _nElements; }
+		[[nodiscard]] const std::vector<size_t>& GetShape() const noexcept { return _shape; }
+
+		[[nodiscard]] T* begin() noexcept { return _data; }
+		[[nodiscard]] T* end() noexcept { return _data + _nElements; }
+		[[nodiscard]] const T* begin() const noexcept { return _data; }
+		[[nodiscard]] const T* end() const noexcept { return _data + _nElements; }
+
+	private:
+		std::shared_ptr<const mm::MappedRegion> _region {};
+		T* _data = nullptr;
+		size_t _nElements = 0;
+		std::vector<size_t> _shape {};
+	};
+
+	/**
+	 * Contiguous read-only array, either pointing straight into a memory mapping (zero-copy) or owning a decoded copy of the data.
+	 * The owner (mapping or copy) is shared, so that the view keeps it alive
+	 */
+	template<typename T>
+	class MappedArray
+	{
+	public:
+		MappedArray() noexcept = default;
+		MappedArray(const T* data_, std::vector<size_t> shape_, std::shared_ptr<const void> owner_, const bool zeroCopy_) noexcept
+			: _data(data_), _nElements(std::accumulate(shape_.begin(), shape_.end(), size_t { 1 }, std::multiplies<>())), _shape(std::move(shape_)), _owner(std::move(owner_)), _zeroCopy(zeroCopy_)
+		{
+		}
+
+		/// take ownership of a decoded array
+		explicit MappedArray(MultiDimensionalArray<T>&& array)
+		{
+			auto copy = std::make_shared<std::vector<T>>(std::move(array.data));
+			_data = copy->data();
+			_nElements = copy->size();
+			_shape = std::move(array.shape);
+			_owner = std::move(copy);
+		}
+
+		/// access element, no range checking
+		// NOLINTNEXTLINE(fuchsia-overloaded-operator)
+		const T& operator[](const size_t i) const noexcept { return _data[i]; }
+
+		[[nodiscard]] const T* data() const noexcept { return _data; }
+		[[nodiscard]] size_t size() const noexcept { return _nElements; }
+		[[nodiscard]] const std::vector<size_t>& GetShape() const noexcept { return _shape; }
+
+		[[nodiscard]] const T* begin() const noexcept { return _data; }
+		[[nodiscard]] const T* end() const noexcept { return _data + _nElements; }
+
+		/// true if the data is read in place from the mapping
+		[[nodiscard]] bool IsZeroCopy() const noexcept { return _zeroCopy; }
+
+	private:
+		const T* _data = nullptr;
+		size_t _nElements = 0;
+		std::vector<size_t> _shape {};
+		std::shared_ptr<const void> _owner {};
+		bool _zeroCopy = false;
+	};
+}	 // namespace npypp
+
+#include <MappedViews.tpp>
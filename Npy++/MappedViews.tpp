@@ -0,0 +1,65 @@
+#pragma once
+
+namespace npypp
+{
+	template<typename T, typename mm::CacheHint ch, typename mm::MapMode mpm>
+	ByteSwappedView<T, ch, mpm>::ByteSwappedView(const mm::MemoryMappedFile<ch, mpm>& mmf) : _region(mmf.GetRegion())
+	{
+		static_assert(mpm != mm::MapMode::WriteOnly, "cannot view a write-only mapping");
+		assert(mmf.IsValid());
+
+		size_t wordSize = 0;
+		bool fortranOrder = false;
+		char endianness = 0;
+		const size_t headerBytes = detail::ParseNpyHeader(mmf.GetData(), wordSize, _shape, fortranOrder, endianness);
+		assert(wordSize == sizeof(T));
+
+		_data = mmf.GetData() + headerBytes;
+		_nElements = std::accumulate(_shape.begin(), _shape.end(), size_t { 1 }, std::multiplies<>());
+		_swap = endianness != '|' && endianness != detail::SysEndianness();
+	}
+
+	template<typename T>
+	template<typename mm::CacheHint ch, typename mm::MapMode mpm>
+	WritableView<T>::WritableView(mm::MemoryMappedFile<ch, mpm>& mmf) : _region(mmf.GetRegion())
+	{
+		static_assert(mpm == mm::MapMode::CopyOnWrite || mpm == mm::MapMode::ReadAndWrite, "cannot modify a read-only or write-only mapping in place");
+		assert(mmf.IsValid());
+
+		size_t wordSize = 0;
+		bool fortranOrder = false;
+		char endianness = 0;
+		const size_t headerBytes = detail::ParseNpyHeader(mmf.GetData(), wordSize, _shape, fortranOrder, endianness);
+		if (wordSize != sizeof(T))
+			throw std::runtime_error("word size mismatch");
+		if (endianness != '|' && endianness != detail::SysEndianness())
+			throw std::runtime_error("cannot modify foreign-endian data in place");
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		_data = reinterpret_cast<T*>(mmf.GetMutableData() + headerBytes);
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		if (reinterpret_cast<uintptr_t>(_data) % alignof(T) != 0)
+			throw std::runtime_error("misaligned data");
+		_nElements = std::accumulate(_shape.begin(), _shape.end(), size_t { 1 }, std::multiplies<>());
+	}
+
+	template<typename T, typename mm::CacheHint ch, typename mm::MapMode mpm>
+	T ByteSwappedView<T, ch, mpm>::operator[](const size_t i) const noexcept
+	{
+		// data is not necessarily aligned to T, hence the memcpy
+		T ret;
+		std::memcpy(&ret, _data + i * sizeof(T), sizeof(T));
+		return _swap ? detail::ByteSwap(ret) : ret;
+	}
+
+	template<typename T, typename mm::CacheHint ch, typename mm::MapMode mpm>
+	void ByteSwappedView<T, ch, mpm>::Gather(const size_t* indices, const size_t nIndices, T* out) const noexcept
+	{
+		// gather first, then swap the contiguous output in a separate pass, which the compiler can vectorize
+		for (size_t i = 0; i < nIndices; ++i)
+			std::memcpy(out + i, _data + indices[i] * sizeof(T), sizeof(T));
+
+		if (_swap)
+			detail::SwapEndianness(out, nIndices);
+	}
+}	 // namespace npypp
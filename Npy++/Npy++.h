@@ -2,16 +2,22 @@
 
 #include <cassert>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include <array>
 
+#include <Compression.h>
+#include <Crc32.h>
 #include <Enumerators.h>
 #include <MemoryMapEnumerators.h>
 #include <MemoryMappedFile.h>
+#include <NumaAllocator.h>
+#include <RandomAccessFile.h>
 #include <StringUtilities.h>
 
 #ifndef _MSC_VER
@@ -38,7 +44,7 @@
 namespace npypp
 {
 	// forward declaration as it's used in detail namespace
-	template<typename T>
+	template<typename T, typename Allocator = std::allocator<T>>
 	struct MultiDimensionalArray;
 
 	namespace detail
@@ -65,6 +71,10 @@ namespace npypp
 		template<typename T>
 		static void appendBytes(std::string& out, const T in);	  // in is by value as it's used only for primitive types
 
+		/// read a little endian field out of a zip record
+		template<typename T>
+		static T readBytes(const char* in);
+
 #pragma region Npy Utilities
 
 		template<typename T>
@@ -93,7 +103,7 @@ namespace npypp
 			// properties needs to end with newline
 
 			static constexpr auto moduloBytes = 16;
-			static constexpr auto preambleBytes = 16;
+			static constexpr auto preambleBytes = 10;
 			auto remainder = moduloBytes - (preambleBytes + properties.size()) % moduloBytes;
 			properties.insert(properties.end(), remainder, ' ');
 			properties.back() = '\n';
@@ -179,6 +189,43 @@ namespace npypp
 			ParseNpyHeader(header, wordSize, shape, fortranOrder, endianness);
 		}
 
+		/// the magic string, version and header length preceding the header: only the first 10 bytes in version 1.0
+		static constexpr size_t npyPreambleSize { 12 };
+
+		/// size in bytes of the full header (i.e. the offset of the array data), given its first npyPreambleSize bytes
+		static inline size_t GetNpyHeaderSize(const unsigned char* preamble) noexcept
+		{
+			// version 1.0 stores the header length in 2 bytes, version 2.0 and 3.0 in 4 bytes
+			if (preamble[6] == 1)
+			{
+				uint16_t headerLength = 0;
+				std::memcpy(&headerLength, preamble + 8, sizeof(headerLength));
+				return 10 + size_t { headerLength };
+			}
+
+			uint32_t headerLength = 0;
+			std::memcpy(&headerLength, preamble + 8, sizeof(headerLength));
+			return 12 + size_t { headerLength };
+		}
+
+		/**
+		 * Parse the header at the beginning of a contiguous npy buffer (e.g. a mapped view), without copying its data.
+		 * Returns the header size in bytes, i.e. the offset of the array data
+		 */
+		static inline size_t ParseNpyHeader(const unsigned char* buffer, size_t& wordSize, std::vector<size_t>& shape, bool& fortranOrder, char& endianness)
+		{
+			assert(buffer[0] == 0x93 && buffer[1] == 'N');
+
+			const size_t headerSize = GetNpyHeaderSize(buffer);
+			const size_t headerOffset = buffer[6] == 1 ? 10 : 12;
+
+			// NOLINTNEXTLINE
+			const std::string header(reinterpret_cast<const char*>(buffer + headerOffset), headerSize - headerOffset);
+			ParseNpyHeader(header, wordSize, shape, fortranOrder, endianness);
+
+			return headerSize;
+		}
+
 		static inline void ParseNpyHeader(FILE* fp, size_t& wordSize, std::vector<size_t>& shape, bool& fortranOrder, char& endianness)
 		{
 			constexpr size_t expectedCharToRead { 11 };
@@ -193,7 +240,7 @@ namespace npypp
 		static void ParseNpyHeader(mm::MemoryMappedFile<ch, mpm>& mmf, size_t& wordSize, std::vector<size_t>& shape, bool& fortranOrder, char& endianness);
 
 		template<typename T>
-		static MultiDimensionalArray<T> LoadFull(FILE* fp);
+		static MultiDimensionalArray<T> LoadFull(FILE* fp, uint64_t releaseBehindBytes = 0);
 
 		template<typename T, typename mm::CacheHint ch = mm::CacheHint::SequentialScan, typename mm::MapMode mpm = mm::MapMode::ReadOnly>
 		static MultiDimensionalArray<T> LoadFull(mm::MemoryMappedFile<ch, mpm>& mmf);
@@ -205,115 +252,494 @@ namespace npypp
 
 #pragma region Npz Utilities
 
-		static inline void ParseNpzFooter(FILE* fp, uint16_t& nRecords, size_t& globalHeaderSize, size_t& globalHeaderOffset)
+		/// fields that don't fit in the 32/16 bits of the original zip records are moved to the zip64 ones
+		static constexpr uint32_t zip64Marker32 { 0xFFFFFFFF };
+		static constexpr uint16_t zip64Marker16 { 0xFFFF };
+		static constexpr uint16_t zip64ExtraFieldId { 0x0001 };
+		static constexpr uint16_t zip64Version { 45 };
+		/// zipalign's extra field: alignment (2 bytes), followed by zeros
+		static constexpr uint16_t alignmentExtraFieldId { 0xD935 };
+		static constexpr size_t alignmentExtraFieldMinSize { 6 };
+		static constexpr size_t maxAlignment { 1u << 15 };
+		/// table of independently decodable blocks ("NB"): uncompressed size of the blocks (8 bytes), and compressed offsets of the next ones (8 bytes each)
+		static constexpr uint16_t blockTableExtraFieldId { 0x424E };
+		/// so that the table fits in an extra field, along with the zip64 one
+		static constexpr size_t maxBlockOffsets { 8000 };
+		static constexpr size_t localHeaderSize { 30 };
+		static constexpr size_t centralHeaderSize { 46 };
+		static constexpr size_t footerSize { 22 };
+		static constexpr size_t zip64FooterSize { 56 };
+		static constexpr size_t zip64LocatorSize { 20 };
+
+		/// a zip member as described by its local and central directory headers
+		struct ZipEntry
 		{
-			constexpr int footerLength { 22 };
-			// footer is 22 chars long, seek the file pointer to 22 places from the end
-			fseek(fp, -footerLength, SEEK_END);
+			std::string name {};	///< including the ".npy" extension
+			uint16_t flags = 0;
+			uint16_t compressionMethod = 0;
+			uint32_t crc = 0;
+			uint64_t compressedBytes = 0;
+			uint64_t uncompressedBytes = 0;
+			uint64_t localHeaderOffset = 0;
+			/// whether the local header carries the sizes in a zip64 extra field, which needs to be decided before the sizes are known
+			bool zip64 = false;
+			/// alignment of the array data, and size of the local header's alignment extra field (0 if there's none, see SetAlignmentPadding)
+			uint16_t alignment = 0;
+			uint16_t alignmentPadding = 0;
+			/// independently decodable blocks, in the central directory only (see SetBlockTable)
+			uint64_t blockBytes = 0;
+			std::vector<uint64_t> blockOffsets {};
+		};
 
-			std::array<char, footerLength> footer {};
-			size_t UNUSED elementsRead = fread(footer.data(), sizeof(char), footerLength, fp);
-			assert(elementsRead == footerLength);
+		/// a member's compressed size may exceed its uncompressed one, by deflate's stored blocks overhead
+		static inline bool NeedsZip64(const uint64_t uncompressedBytes)
+		{
+			constexpr uint64_t maxOverheadBytes { 1u << 16 };
+			return uncompressedBytes + uncompressedBytes / 1000 + maxOverheadBytes >= zip64Marker32;
+		}
 
-			std::memcpy(&nRecords, &footer[10], sizeof(nRecords));
+		/**
+		 * Parse the end of central directory record at the end of footer, which holds the last footerLength bytes of the file.
+		 * Returns the offset of the zip64 footer if footer starts with its locator (footerLength must be then zip64LocatorSize + footerSize), 0 otherwise
+		 */
+		static inline uint64_t ParseEndOfCentralDirectory(const char* footer, const size_t footerLength, uint64_t& nRecords, uint64_t& globalHeaderSize, uint64_t& globalHeaderOffset)
+		{
+			const char* eocd = footer + footerLength - footerSize;
+			if (readBytes<uint32_t>(eocd) != 0x06054b50)
+				throw std::runtime_error("end of central directory record not found");
+			nRecords = readBytes<uint16_t>(eocd + 10);
+			globalHeaderSize = readBytes<uint32_t>(eocd + 12);
+			globalHeaderOffset = readBytes<uint32_t>(eocd + 16);
+
+			assert(readBytes<uint16_t>(eocd + 4) == 0);
+			assert(readBytes<uint16_t>(eocd + 6) == 0);
+			assert(readBytes<uint16_t>(eocd + 8) == nRecords);
+			assert(readBytes<uint16_t>(eocd + 20) == 0);
+
+			if (footerLength < zip64LocatorSize + footerSize || readBytes<uint32_t>(footer) != 0x07064b50)
+				return 0;
+			return readBytes<uint64_t>(footer + 8);
+		}
 
-			uint32_t tmp = 0;
-			std::memcpy(&tmp, &footer[12], sizeof(uint32_t));
-			globalHeaderSize = tmp;
+		/// zip64: the actual values are in the zip64 footer
+		static inline void ParseZip64Footer(const char* zip64Footer, uint64_t& nRecords, uint64_t& globalHeaderSize, uint64_t& globalHeaderOffset)
+		{
+			if (readBytes<uint32_t>(zip64Footer) != 0x06064b50)
+				throw std::runtime_error("zip64 end of central directory record not found");
 
-			std::memcpy(&tmp, &footer[16], sizeof(uint32_t));
-			globalHeaderOffset = tmp;
+			nRecords = readBytes<uint64_t>(zip64Footer + 32);
+			globalHeaderSize = readBytes<uint64_t>(zip64Footer + 40);
+			globalHeaderOffset = readBytes<uint64_t>(zip64Footer + 48);
+		}
 
-#ifndef NDEBUG
-			uint16_t tmp2 = 0;
-			std::memcpy(&tmp2, &footer[4], sizeof(tmp2));
-			assert(tmp2 == 0);
-			std::memcpy(&tmp2, &footer[6], sizeof(tmp2));
-			assert(tmp2 == 0);
-			std::memcpy(&tmp2, &footer[8], sizeof(tmp2));
-			assert(tmp2 == nRecords);
-			std::memcpy(&tmp2, &footer[20], sizeof(tmp2));
-			assert(tmp2 == 0);
-#endif
+		static inline void ParseNpzFooter(FILE* fp, uint64_t& nRecords, uint64_t& globalHeaderSize, uint64_t& globalHeaderOffset)
+		{
+			// footer is 22 chars long, optionally preceded by the zip64 footer and its 20 chars locator
+			std::array<char, zip64LocatorSize + footerSize> footer {};
+			if (!Seek(fp, 0, SEEK_END))
+				throw std::runtime_error("end of central directory record not found");
+			const bool hasLocator = Tell(fp) >= static_cast<int64_t>(footer.size());
+			const size_t footerLength = hasLocator ? footer.size() : footerSize;
+
+			if (!Seek(fp, -static_cast<int64_t>(footerLength), SEEK_END) || fread(footer.data(), sizeof(char), footerLength, fp) != footerLength)
+				throw std::runtime_error("end of central directory record not found");
+
+			const uint64_t zip64FooterOffset = ParseEndOfCentralDirectory(footer.data(), footerLength, nRecords, globalHeaderSize, globalHeaderOffset);
+			if (zip64FooterOffset == 0)
+				return;
+
+			std::array<char, zip64FooterSize> zip64Footer {};
+			if (!Seek(fp, static_cast<int64_t>(zip64FooterOffset), SEEK_SET) || fread(zip64Footer.data(), sizeof(char), zip64Footer.size(), fp) != zip64Footer.size())
+				throw std::runtime_error("zip64 end of central directory record not found");
+			ParseZip64Footer(zip64Footer.data(), nRecords, globalHeaderSize, globalHeaderOffset);
+		}
+
+		/// same as above, with positional reads
+		static inline void ParseNpzFooter(const RandomAccessFile& file, uint64_t& nRecords, uint64_t& globalHeaderSize, uint64_t& globalHeaderOffset)
+		{
+			std::array<char, zip64LocatorSize + footerSize> footer {};
+			const size_t footerLength = file.size() >= footer.size() ? footer.size() : footerSize;
+			if (file.size() < footerLength || !file.ReadAt(footer.data(), footerLength, file.size() - footerLength))
+				throw std::runtime_error("end of central directory record not found");
+
+			const uint64_t zip64FooterOffset = ParseEndOfCentralDirectory(footer.data(), footerLength, nRecords, globalHeaderSize, globalHeaderOffset);
+			if (zip64FooterOffset == 0)
+				return;
+
+			std::array<char, zip64FooterSize> zip64Footer {};
+			if (!file.ReadAt(zip64Footer.data(), zip64Footer.size(), zip64FooterOffset))
+				throw std::runtime_error("zip64 end of central directory record not found");
+			ParseZip64Footer(zip64Footer.data(), nRecords, globalHeaderSize, globalHeaderOffset);
+		}
+
+		/// same as above, for a file that's fully in memory (e.g. memory mapped)
+		static inline void ParseNpzFooter(const char* file, const uint64_t fileSize, uint64_t& nRecords, uint64_t& globalHeaderSize, uint64_t& globalHeaderOffset)
+		{
+			if (fileSize < footerSize)
+				throw std::runtime_error("end of central directory record not found");
+
+			const size_t footerLength = fileSize >= zip64LocatorSize + footerSize ? zip64LocatorSize + footerSize : footerSize;
+			const uint64_t zip64FooterOffset = ParseEndOfCentralDirectory(file + fileSize - footerLength, footerLength, nRecords, globalHeaderSize, globalHeaderOffset);
+			if (zip64FooterOffset == 0)
+				return;
+
+			if (zip64FooterOffset + zip64FooterSize > fileSize)
+				throw std::runtime_error("zip64 end of central directory record not found");
+			ParseZip64Footer(file + zip64FooterOffset, nRecords, globalHeaderSize, globalHeaderOffset);
+		}
+
+		/**
+		 * Parse the zip64 extra field, if any, out of a header's extra fields. Only the fields whose 32 bits value is the zip64
+		 * marker are stored, in this order
+		 */
+		static inline void ParseZip64ExtraField(const char* extraFields, const size_t extraFieldsLength, uint64_t& uncompressedBytes, uint64_t& compressedBytes, uint64_t* localHeaderOffset = nullptr)
+		{
+			size_t position = 0;
+			while (position + 4 <= extraFieldsLength)
+			{
+				const auto id = readBytes<uint16_t>(extraFields + position);
+				const auto size = readBytes<uint16_t>(extraFields + position + 2);
+				position += 4;
+				if (id == zip64ExtraFieldId)
+				{
+					// the values must fit in both the declared size of the field and the extra fields
+					const size_t fieldEnd = std::min<size_t>(position + size, extraFieldsLength);
+					const auto read = [&](uint64_t& value)
+					{
+						if (value != zip64Marker32)
+							return;
+						if (position + sizeof(uint64_t) > fieldEnd)
+							throw std::runtime_error("invalid zip64 extra field");
+						value = readBytes<uint64_t>(extraFields + position);
+						position += sizeof(uint64_t);
+					};
+					read(uncompressedBytes);
+					read(compressedBytes);
+					if (localHeaderOffset != nullptr)
+						read(*localHeaderOffset);
+					return;
+				}
+				position += size;
+			}
+		}
+
+		/**
+		 * Record the independently decodable blocks of a deflated member, every blockBytes uncompressed bytes and starting at
+		 * blockOffsets in the compressed stream (the first one excluded). Blocks are merged two by two until the table fits in an extra field
+		 */
+		static inline void SetBlockTable(ZipEntry& entry, uint64_t blockBytes, std::vector<uint64_t> blockOffsets)
+		{
+			while (blockOffsets.size() > maxBlockOffsets)
+			{
+				// the (2k+1)th offset, i.e. the one of block 2(k+1), starts block k+1 of the merged table
+				for (size_t i = 1; i < blockOffsets.size(); i += 2)
+					blockOffsets[i / 2] = blockOffsets[i];
+				blockOffsets.resize(blockOffsets.size() / 2);
+				blockBytes *= 2;
+			}
+
+			entry.blockBytes = blockOffsets.empty() ? 0 : blockBytes;
+			entry.blockOffsets = std::move(blockOffsets);
+		}
+
+		static inline void ParseBlockTableExtraField(const char* extraFields, const size_t extraFieldsLength, ZipEntry& entry)
+		{
+			size_t position = 0;
+			while (position + 4 <= extraFieldsLength)
+			{
+				const auto id = readBytes<uint16_t>(extraFields + position);
+				const auto size = readBytes<uint16_t>(extraFields + position + 2);
+				position += 4;
+				if (id == blockTableExtraFieldId && size >= sizeof(uint64_t) && position + size <= extraFieldsLength)
+				{
+					entry.blockBytes = readBytes<uint64_t>(extraFields + position);
+					for (size_t i = sizeof(uint64_t); i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+						entry.blockOffsets.push_back(readBytes<uint64_t>(extraFields + position + i));
+					return;
+				}
+				position += size;
+			}
+		}
+
+		/// alignment recorded in the alignment extra field, if any, out of a local header's extra fields
+		static inline uint16_t ParseAlignmentExtraField(const char* extraFields, const size_t extraFieldsLength)
+		{
+			size_t position = 0;
+			while (position + 4 <= extraFieldsLength)
+			{
+				const auto id = readBytes<uint16_t>(extraFields + position);
+				const auto size = readBytes<uint16_t>(extraFields + position + 2);
+				position += 4;
+				if (id == alignmentExtraFieldId && size >= 2 && position + 2 <= extraFieldsLength)
+					return readBytes<uint16_t>(extraFields + position);
+				position += size;
+			}
+			return 0;
 		}
 
 		template<typename T>
-		static uint32_t GetCrcNpyFile(const std::string& npyHeader, const std::vector<T>& data);
+		static uint32_t GetCrcNpyFile(const std::string& npyHeader, const std::vector<T>& data, const size_t nThreads = 0);
 
-		static inline std::string GetLocalHeader(const uint32_t crc, const uint32_t nBytes, const std::string& localNpyFileName)
+		static inline std::string GetLocalHeader(const ZipEntry& entry)
 		{
 			std::string ret("PK");				   // signature magic
 			appendBytes<uint16_t>(ret, 0x0403);	   // signature magic
 
-			appendBytes<uint16_t>(ret, 20);	   // min version to extract
-			appendBytes<uint16_t>(ret, 0);	   // general purpose bit flag
-			appendBytes<uint16_t>(ret, 0);	   // compression method
-			appendBytes<uint16_t>(ret, 0);	   // file last mod time
-			appendBytes<uint16_t>(ret, 0);	   // file last mod date
+			appendBytes<uint16_t>(ret, entry.zip64 ? zip64Version : 20);	// min version to extract
+			appendBytes<uint16_t>(ret, entry.flags);						// general purpose bit flag
+			appendBytes<uint16_t>(ret, entry.compressionMethod);			// 0: stored, 8: deflate
+			appendBytes<uint16_t>(ret, 0);									// file last mod time
+			appendBytes<uint16_t>(ret, 0);									// file last mod date
 
-			appendBytes<uint32_t>(ret, crc);
-			appendBytes<uint32_t>(ret, nBytes);	   // compressed size
-			appendBytes<uint32_t>(ret, nBytes);	   // uncompressed size
+			appendBytes<uint32_t>(ret, entry.crc);
+			appendBytes<uint32_t>(ret, entry.zip64 ? zip64Marker32 : static_cast<uint32_t>(entry.compressedBytes));
+			appendBytes<uint32_t>(ret, entry.zip64 ? zip64Marker32 : static_cast<uint32_t>(entry.uncompressedBytes));
 
-			appendBytes<uint16_t>(ret, static_cast<uint16_t>(localNpyFileName.size()));	   // npy file size
-			appendBytes<uint16_t>(ret, 0);												   // extra field length
+			appendBytes<uint16_t>(ret, static_cast<uint16_t>(entry.name.size()));						  // npy file size
+			appendBytes<uint16_t>(ret, static_cast<uint16_t>((entry.zip64 ? 20 : 0) + entry.alignmentPadding));	  // extra field length
+
+			ret += entry.name;
+
+			if (entry.zip64)
+			{
+				// in the local header, zip64 extra field must contain both sizes
+				appendBytes<uint16_t>(ret, zip64ExtraFieldId);
+				appendBytes<uint16_t>(ret, 16);
+				appendBytes<uint64_t>(ret, entry.uncompressedBytes);
+				appendBytes<uint64_t>(ret, entry.compressedBytes);
+			}
 
-			ret += localNpyFileName;
+			if (entry.alignmentPadding > 0)
+			{
+				appendBytes<uint16_t>(ret, alignmentExtraFieldId);
+				appendBytes<uint16_t>(ret, static_cast<uint16_t>(entry.alignmentPadding - 4));
+				appendBytes<uint16_t>(ret, entry.alignment);
+				ret.append(entry.alignmentPadding - alignmentExtraFieldMinSize, '\0');
+			}
 
 			return ret;
 		}
 
-		static inline void AppendGlobalHeader(std::string& out, const std::string& localHeader, const uint32_t globalHeaderOffset, const std::string& localNpyFileName)
+		/// size of the local header written by GetLocalHeader
+		static inline uint64_t GetLocalHeaderSize(const ZipEntry& entry) noexcept { return localHeaderSize + entry.name.size() + (entry.zip64 ? 20 : 0) + entry.alignmentPadding; }
+
+		/**
+		 * Size the local header's alignment extra field so that the array data of a stored member, which starts npyHeaderBytes into the
+		 * member, lands on a multiple of alignment bytes. Deflated members, and alignment 0, get no padding
+		 */
+		static inline void SetAlignmentPadding(ZipEntry& entry, const uint64_t npyHeaderBytes, const size_t alignment)
+		{
+			entry.alignment = 0;
+			entry.alignmentPadding = 0;
+			if (alignment <= 1 || entry.compressionMethod != 0)
+				return;
+			if (alignment > maxAlignment || (alignment & (alignment - 1)) != 0)
+				throw std::runtime_error("alignment must be a power of 2, up to " + std::to_string(maxAlignment));
+
+			const uint64_t dataOffset = entry.localHeaderOffset + GetLocalHeaderSize(entry) + alignmentExtraFieldMinSize + npyHeaderBytes;
+			entry.alignment = static_cast<uint16_t>(alignment);
+			entry.alignmentPadding = static_cast<uint16_t>(alignmentExtraFieldMinSize + (alignment - dataOffset % alignment) % alignment);
+		}
+
+		static inline void AppendGlobalHeader(std::string& out, const ZipEntry& entry)
 		{
+			std::string zip64ExtraField;
+			const auto toZip32 = [&zip64ExtraField](const uint64_t value, const bool forceZip64)
+			{
+				if (value < zip64Marker32 && !forceZip64)
+					return static_cast<uint32_t>(value);
+
+				appendBytes<uint64_t>(zip64ExtraField, value);
+				return zip64Marker32;
+			};
+
+			// the order of the fields in the zip64 extra field is fixed. Sizes agree with the local header
+			const uint32_t uncompressedBytes = toZip32(entry.uncompressedBytes, entry.zip64);
+			const uint32_t compressedBytes = toZip32(entry.compressedBytes, entry.zip64);
+			const uint32_t localHeaderOffset = toZip32(entry.localHeaderOffset, false);
+			const bool zip64 = !zip64ExtraField.empty();
+
+			std::string extraFields;
+			if (zip64)
+			{
+				appendBytes<uint16_t>(extraFields, zip64ExtraFieldId);
+				appendBytes<uint16_t>(extraFields, static_cast<uint16_t>(zip64ExtraField.size()));
+				extraFields += zip64ExtraField;
+			}
+			if (!entry.blockOffsets.empty())
+			{
+				appendBytes<uint16_t>(extraFields, blockTableExtraFieldId);
+				appendBytes<uint16_t>(extraFields, static_cast<uint16_t>(sizeof(uint64_t) * (entry.blockOffsets.size() + 1)));
+				appendBytes<uint64_t>(extraFields, entry.blockBytes);
+				for (const auto blockOffset : entry.blockOffsets)
+					appendBytes<uint64_t>(extraFields, blockOffset);
+			}
+
 			out += "PK";						   // signature magic
 			appendBytes<uint16_t>(out, 0x0201);	   // signature magic
 
-			appendBytes<uint16_t>(out, 20);	   // version made by
+			appendBytes<uint16_t>(out, zip64 ? zip64Version : 20);	  // version made by
+			appendBytes<uint16_t>(out, zip64 ? zip64Version : 20);	  // min version to extract
+			appendBytes<uint16_t>(out, entry.flags);				  // general purpose bit flag
+			appendBytes<uint16_t>(out, entry.compressionMethod);	  // 0: stored, 8: deflate
+			appendBytes<uint16_t>(out, 0);							  // file last mod time
+			appendBytes<uint16_t>(out, 0);							  // file last mod date
 
-			out.insert(out.end(), localHeader.begin() + 4, localHeader.begin() + 30);	 // insert local header
+			appendBytes<uint32_t>(out, entry.crc);
+			appendBytes<uint32_t>(out, compressedBytes);
+			appendBytes<uint32_t>(out, uncompressedBytes);
 
-			appendBytes<uint16_t>(out, 0);	  // file comment length
-			appendBytes<uint16_t>(out, 0);	  // disk number where file starts
-			appendBytes<uint16_t>(out, 0);	  // internal file attributes
+			appendBytes<uint16_t>(out, static_cast<uint16_t>(entry.name.size()));	   // npy file size
+			appendBytes<uint16_t>(out, static_cast<uint16_t>(extraFields.size()));	   // extra field length
+			appendBytes<uint16_t>(out, 0);											   // file comment length
+			appendBytes<uint16_t>(out, 0);											   // disk number where file starts
+			appendBytes<uint16_t>(out, 0);											   // internal file attributes
 
-			appendBytes<uint32_t>(out, 0);					   // external file attributes
-			appendBytes<uint32_t>(out, globalHeaderOffset);	   // relative offset of local file header, since it begins where the global header used to begin
+			appendBytes<uint32_t>(out, 0);					  // external file attributes
+			appendBytes<uint32_t>(out, localHeaderOffset);	  // relative offset of local file header
 
-			out += localNpyFileName;
+			out += entry.name;
+			out += extraFields;
 		}
 
-		static inline std::string GetNpzFooter(const std::string& globalHeader, const uint32_t globalHeaderOffset, const uint32_t localHeaderSize, const uint32_t nElementsInBytes, const uint16_t nNewRecords)
+		/// parse the central directory records (the "global header"), in archive order
+		static inline std::vector<ZipEntry> ParseCentralDirectory(const char* buffer, const size_t size)
 		{
-			std::string ret("PK");				   // signature magic
+			std::vector<ZipEntry> ret;
+			size_t position = 0;
+			while (position + centralHeaderSize <= size)
+			{
+				const char* header = buffer + position;
+				if (readBytes<uint32_t>(header) != 0x02014b50)
+					throw std::runtime_error("invalid central directory record");
+
+				ZipEntry entry;
+				entry.flags = readBytes<uint16_t>(header + 8);
+				entry.compressionMethod = readBytes<uint16_t>(header + 10);
+				entry.crc = readBytes<uint32_t>(header + 16);
+				entry.compressedBytes = readBytes<uint32_t>(header + 20);
+				entry.uncompressedBytes = readBytes<uint32_t>(header + 24);
+				entry.localHeaderOffset = readBytes<uint32_t>(header + 42);
+
+				const auto nameLength = readBytes<uint16_t>(header + 28);
+				const auto extraFieldsLength = readBytes<uint16_t>(header + 30);
+				const auto commentLength = readBytes<uint16_t>(header + 32);
+				if (position + centralHeaderSize + nameLength + extraFieldsLength + commentLength > size)
+					throw std::runtime_error("truncated central directory");
+
+				entry.name.assign(header + centralHeaderSize, nameLength);
+				const char* extraFields = header + centralHeaderSize + nameLength;
+				entry.zip64 = entry.compressedBytes == zip64Marker32 || entry.uncompressedBytes == zip64Marker32;
+				ParseZip64ExtraField(extraFields, extraFieldsLength, entry.uncompressedBytes, entry.compressedBytes, &entry.localHeaderOffset);
+				ParseBlockTableExtraField(extraFields, extraFieldsLength, entry);
+
+				ret.push_back(std::move(entry));
+				position += centralHeaderSize + nameLength + extraFieldsLength + commentLength;
+			}
+
+			return ret;
+		}
+
+		/// the zip64 footer and its locator are written only if any of the values overflows the original footer, or if forced
+		static inline std::string GetNpzFooter(const uint64_t nRecords, const uint64_t globalHeaderSize, const uint64_t globalHeaderOffset, const bool forceZip64 = false)
+		{
+			const bool zip64 = forceZip64 || nRecords >= zip64Marker16 || globalHeaderSize >= zip64Marker32 || globalHeaderOffset >= zip64Marker32;
+
+			std::string ret;
+			if (zip64)
+			{
+				ret += "PK";						   // signature magic
+				appendBytes<uint16_t>(ret, 0x0606);	   // signature magic
+
+				appendBytes<uint64_t>(ret, zip64FooterSize - 12);	 // size of the remaining record
+				appendBytes<uint16_t>(ret, zip64Version);			 // version made by
+				appendBytes<uint16_t>(ret, zip64Version);			 // min version to extract
+				appendBytes<uint32_t>(ret, 0);						 // number of this disk
+				appendBytes<uint32_t>(ret, 0);						 // disk where footer starts
+				appendBytes<uint64_t>(ret, nRecords);				 // number of records on this disk
+				appendBytes<uint64_t>(ret, nRecords);				 // total number of records
+				appendBytes<uint64_t>(ret, globalHeaderSize);		 // nbytes of global headers
+				appendBytes<uint64_t>(ret, globalHeaderOffset);		 // offset of start of global headers
+
+				// locator
+				ret += "PK";						   // signature magic
+				appendBytes<uint16_t>(ret, 0x0706);	   // signature magic
+
+				appendBytes<uint32_t>(ret, 0);										   // disk where the zip64 footer starts
+				appendBytes<uint64_t>(ret, globalHeaderOffset + globalHeaderSize);	   // offset of the zip64 footer, right after the global headers
+				appendBytes<uint32_t>(ret, 1);										   // total number of disks
+			}
+
+			ret += "PK";						   // signature magic
 			appendBytes<uint16_t>(ret, 0x0605);	   // signature magic
 
 			appendBytes<uint16_t>(ret, 0);	  // number of this disk
 			appendBytes<uint16_t>(ret, 0);	  // disk where footer starts
 
-			appendBytes<uint16_t>(ret, nNewRecords);	// number of records on this disk
-			appendBytes<uint16_t>(ret, nNewRecords);	// total number of records
+			const auto nRecords16 = static_cast<uint16_t>(std::min<uint64_t>(nRecords, zip64Marker16));
+			appendBytes<uint16_t>(ret, nRecords16);	   // number of records on this disk
+			appendBytes<uint16_t>(ret, nRecords16);	   // total number of records
 
-			appendBytes<uint32_t>(ret, static_cast<uint32_t>(globalHeader.size()));					// nbytes of global headers
-			appendBytes<uint32_t>(ret, globalHeaderOffset + nElementsInBytes + localHeaderSize);	// offset of start of global headers, since global header now starts after newly written array
+			appendBytes<uint32_t>(ret, static_cast<uint32_t>(std::min<uint64_t>(globalHeaderSize, zip64Marker32)));		 // nbytes of global headers
+			appendBytes<uint32_t>(ret, static_cast<uint32_t>(std::min<uint64_t>(globalHeaderOffset, zip64Marker32)));	 // offset of start of global headers
 
 			appendBytes<uint16_t>(ret, 0);	  // zip file comment length
 
 			return ret;
 		}
+
+		/// write a placeholder local header at the current position of fp, which is offset in the file. The payload follows through a MemberWriter
 		template<typename T>
-		MultiDimensionalArray<T> LoadCompressedFull(FILE* fp, uint32_t compressedBytes, uint32_t uncompressedBytes);
+		ZipEntry BeginMember(FILE* fp, uint64_t offset, std::string zipName, const std::vector<size_t>& shape, const CompressionOptions& options);
+
+		/// finish the member's payload, and patch its local header with the CRC and sizes, leaving fp at the end of the member
+		void EndMember(FILE* fp, ZipEntry& entry, MemberWriter& memberWriter);
+
+		/**
+		 * Write a member (local header and payload) at the current position of fp, which is offset in the file, leaving fp at its end.
+		 * Returns the member's central directory record
+		 */
+		template<typename T>
+		ZipEntry WriteMember(FILE* fp, uint64_t offset, std::string zipName, const T* data, const std::vector<size_t>& shape, const CompressionOptions& options);
+
+		/**
+		 * Load a stored member whose data (i.e. npy header) starts at offset.
+		 * If crc is not null, it's set to the CRC of the member as stored in the archive (i.e. header and data before any endianness swap), computed on nThreads threads
+		 */
+		template<typename T>
+		MultiDimensionalArray<T> LoadStoredMember(const RandomAccessFile& file, uint64_t offset, uint32_t* crc = nullptr, size_t nThreads = 0);
+
+		/// inflate a deflated member whose compressed bytes start at offset, streaming them through a small buffer
+		template<typename T>
+		MultiDimensionalArray<T> LoadCompressedFull(const RandomAccessFile& file, uint64_t offset, uint64_t compressedBytes, uint64_t uncompressedBytes, uint32_t* crc = nullptr);
+
+		/**
+		 * Inflate a deflated member made of independently decodable blocks (see CompressionOptions::fullFlushBytes), on up to nThreads
+		 * threads: each block is inflated straight into its part of the array, and the CRCs of the blocks are combined
+		 */
+		template<typename T>
+		MultiDimensionalArray<T> LoadCompressedBlocks(const RandomAccessFile& file, uint64_t offset, uint64_t compressedBytes, uint64_t uncompressedBytes, uint64_t blockBytes,
+													  const std::vector<uint64_t>& blockOffsets, uint32_t* crc = nullptr, size_t nThreads = 0);
+
+		/// inflate a member from a buffer holding its compressed bytes
+		template<typename T>
+		MultiDimensionalArray<T> InflateMember(const unsigned char* bufferCompressed, uint64_t compressedBytes, uint64_t uncompressedBytes, uint32_t* crc = nullptr);
+
+		/// inflate the npy header, then the array data straight into the returned array
+		template<typename T>
+		MultiDimensionalArray<T> InflateMember(MemberReader& reader, uint64_t uncompressedBytes);
 
 #pragma endregion
 	}	 // namespace detail
 
 #pragma region Convenience Types
 
-	template<typename T>
+	template<typename T, typename Allocator>
 	struct MultiDimensionalArray
 	{
-		MultiDimensionalArray(const std::vector<T>& data_, std::vector<size_t> shape_) : data(data_), shape(std::move(shape_)) {}
+		MultiDimensionalArray(const std::vector<T, Allocator>& data_, std::vector<size_t> shape_) : data(data_), shape(std::move(shape_)) {}
 
-		MultiDimensionalArray(const std::vector<T>& data_, std::vector<size_t>&& shape_) : data(data_), shape(shape_) {}
+		MultiDimensionalArray(const std::vector<T, Allocator>& data_, std::vector<size_t>&& shape_) : data(data_), shape(shape_) {}
 
 		MultiDimensionalArray() = default;
 		~MultiDimensionalArray() = default;
@@ -322,7 +748,7 @@ namespace npypp
 		MultiDimensionalArray& operator=(const MultiDimensionalArray&) = default;
 		MultiDimensionalArray& operator=(MultiDimensionalArray&&) noexcept = default;
 
-		std::vector<T> data {};
+		std::vector<T, Allocator> data {};
 		std::vector<size_t> shape {};
 	};
 
@@ -378,10 +804,28 @@ namespace npypp
 	}
 
 	/**
-	 * Load the full info (data and shape) from the file
+	 * Load the full info (data and shape) from the file.
+	 * If releaseBehindBytes isn't 0, the file is read in chunks, and what's more than releaseBehindBytes behind is dropped from
+	 * the page cache (and from the mapping), so that reading a large file once doesn't evict everything else
+	 */
+	template<typename T>
+	MultiDimensionalArray<T> LoadFull(const std::string& fileName, const bool useMemoryMap = false, uint64_t releaseBehindBytes = 0);
+
+	/**
+	 * Load the data into a vector with any allocator, e.g. mm::HugePageAllocator for arrays accessed at random, and return the shape.
+	 * releaseBehindBytes as for LoadFull
+	 */
+	template<typename T, typename Allocator>
+	std::vector<size_t> LoadInto(const std::string& fileName, std::vector<T, Allocator>& data, uint64_t releaseBehindBytes = 0);
+
+	/**
+	 * Load the full info (data and shape) from the file, placing the array on NUMA nodes according to policy before it's touched:
+	 * the array is a fresh mapping (mm::NumaAllocator), whose pages are first touched by the threads reading them.
+	 * With mm::NumaPlacement::Partition, the array is split by rows, one range per node, each one read by a thread running on its node.
+	 * Throws if the policy can't be applied on a system with several nodes
 	 */
 	template<typename T>
-	MultiDimensionalArray<T> LoadFull(const std::string& fileName, const bool useMemoryMap = false);
+	MultiDimensionalArray<T, mm::NumaAllocator<T>> LoadFull(const std::string& fileName, const mm::NumaPolicy& policy);
 
 	/**
 	 * Load the full info (data and shape) from the file using an externally set memory mapped file
@@ -419,52 +863,65 @@ namespace npypp
 
 #pragma endregion
 
+	/// ordered by name, so that iterating doesn't depend on the order in which members were loaded
 	template<typename T>
-	using CompressedMap = std::unordered_map<std::string, std::vector<T>>;
+	using CompressedMap = std::map<std::string, std::vector<T>>;
 
 	template<typename T>
-	using CompressedMapFull = std::unordered_map<std::string, MultiDimensionalArray<T>>;
+	using CompressedMapFull = std::map<std::string, MultiDimensionalArray<T>>;
+
+	struct NpzLoadOptions
+	{
+		/// compare each member's CRC with the one recorded in the archive, throwing std::runtime_error on mismatch
+		bool verifyCrc = false;
+		/// members are read and inflated concurrently on up to nThreads threads, 0 uses all hardware threads
+		size_t nThreads = 1;
+
+		/**
+		 * Partial reads of deflated members (NpzArchive::LoadRows): uncompressed bytes between the checkpoints of their access index,
+		 * built on first access. 0 disables it, rows are then inflated from the start of the member
+		 */
+		uint64_t checkpointBytes = 0;
+		/// file caching the access indices across runs, e.g. the archive's name followed by ".zran" (none if empty)
+		std::string indexFileName {};
+	};
 
 #pragma region Load / Save Npz
 
 	/**
-	 * Since *.npz files supports multiple arrays in a single file, the variable name needs to be specified
+	 * Since *.npz files supports multiple arrays in a single file, the variable name needs to be specified.
+	 * By default members are deflated as in numpy.savez_compressed, use CompressionMethod::Stored for numpy.savez.
+	 * Each call rewrites the central directory: use NpzWriter to write many members
 	 */
 	template<typename T>
-	void SaveCompressed(const std::string& zipFileName, std::string vectorName, const std::vector<T>& data, const std::vector<size_t>& shape, const std::string& mode = "w");
+	void SaveCompressed(const std::string& zipFileName, std::string vectorName, const std::vector<T>& data, const std::vector<size_t>& shape, const std::string& mode = "w",
+						const CompressionOptions& options = {});
 
 	/**
 	 * If vector name is not provided, it's extracted by the zipfile name
 	 */
 	template<typename T>
-	void SaveCompressed(const std::string& zipFileName, const std::vector<T>& data, const std::vector<size_t>& shape, const std::string& mode = "w")
+	void SaveCompressed(const std::string& zipFileName, const std::vector<T>& data, const std::vector<size_t>& shape, const std::string& mode = "w", const CompressionOptions& options = {})
 	{
 		std::string vectorName(zipFileName);
 		vectorName.replace(vectorName.end() - 4, vectorName.end(), "");
 
-		SaveCompressed(zipFileName, vectorName, data, shape, mode);
+		SaveCompressed(zipFileName, vectorName, data, shape, mode, options);
 	}
 
 	/**
+	 * Members are located through the archive's central directory, and loaded on NpzLoadOptions::nThreads threads (see NpzArchive).
 	 * Limitations: map has only one value type, so you cannot load different types in the same file
 	 */
 	template<typename T>
-	CompressedMapFull<T> LoadCompressedFull(const std::string& zipFileName);
+	CompressedMapFull<T> LoadCompressedFull(const std::string& zipFileName, const NpzLoadOptions& options = {});
 
 	/**
-	 * Limitations: map has only one value type, so you cannot load different types in the same file
+	 * Only the requested member is read, through the archive's central directory (see NpzArchive).
+	 * Returns an empty array if there's no such member
 	 */
 	template<typename T>
-	MultiDimensionalArray<T> LoadCompressedFull(const std::string& zipFileName, const std::string& vectorName)
-	{
-		CompressedMapFull<T> fullInfo = LoadCompressedFull<T>(zipFileName);
-
-		auto iter = fullInfo.find(vectorName);
-		if (iter == fullInfo.end())
-			return MultiDimensionalArray<T>();
-
-		return iter->second;
-	}
+	MultiDimensionalArray<T> LoadCompressedFull(const std::string& zipFileName, const std::string& vectorName, const NpzLoadOptions& options = {});
 
 	/**
 	 * Limitations: map has only one value type, so you cannot load different types in the same file
@@ -494,3 +951,5 @@ namespace npypp
 }	 // namespace npypp
 
 #include <Npy++.tpp>
+#include <NpzArchive.h>
+#include <NpzWriter.h>
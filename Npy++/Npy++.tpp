@@ -2,6 +2,7 @@
 
 #include <complex>
 #include <numeric>
+#include <stdexcept>
 
 #include <StringUtilities.h>
 #include <zlib.h>
@@ -62,6 +63,14 @@ namespace npypp
 				out += *(inPtr + byteIndex);
 		}
 
+		template<typename T>
+		T readBytes(const char* in)
+		{
+			T ret;
+			std::memcpy(&ret, in, sizeof(T));
+			return ret;
+		}
+
 #pragma region Npy Header
 
 		template<typename T>
@@ -118,19 +127,65 @@ namespace npypp
 #pragma endregion
 
 		template<typename T>
-		[[maybe_unused]] static void SwapEndianness(T* buffer, size_t size)
+		struct ByteSwapper
 		{
-			constexpr size_t sizeOfT = sizeof(T);
-			for (size_t i = 0; i < size; i++)
+			static T Swap(const T value) noexcept
 			{
-				// NOLINTNEXTLINE
-				const auto* src = reinterpret_cast<uint8_t*>(buffer + i);
-				std::array<uint8_t, sizeOfT> dst;
-				for (size_t j = 0; j < sizeOfT; j++)
-					dst[j] = src[sizeOfT - j - 1];
+				constexpr size_t sizeOfT = sizeof(T);
+				if constexpr (sizeOfT == 1)
+					return value;
+#ifndef _MSC_VER
+				// single bswap instructions, which also let the compiler vectorize loops over contiguous buffers
+				else if constexpr (sizeOfT == 2)
+					return Reinterpret<T>(__builtin_bswap16(Reinterpret<uint16_t>(value)));
+				else if constexpr (sizeOfT == 4)
+					return Reinterpret<T>(__builtin_bswap32(Reinterpret<uint32_t>(value)));
+				else if constexpr (sizeOfT == 8)
+					return Reinterpret<T>(__builtin_bswap64(Reinterpret<uint64_t>(value)));
+#endif
+				else
+				{
+					std::array<uint8_t, sizeOfT> src;
+					std::array<uint8_t, sizeOfT> dst;
+					std::memcpy(src.data(), &value, sizeOfT);
+					for (size_t j = 0; j < sizeOfT; j++)
+						dst[j] = src[sizeOfT - j - 1];
+
+					T ret;
+					std::memcpy(&ret, dst.data(), sizeOfT);
+					return ret;
+				}
+			}
 
-				std::memcpy(buffer + i, dst.data(), sizeOfT);
+		private:
+			template<typename U, typename V>
+			static U Reinterpret(const V value) noexcept
+			{
+				static_assert(sizeof(U) == sizeof(V));
+				U ret;
+				std::memcpy(&ret, &value, sizeof(U));
+				return ret;
 			}
+		};
+
+		/// complex numbers are stored as two contiguous scalars, each of them swapped on its own
+		template<typename T>
+		struct ByteSwapper<std::complex<T>>
+		{
+			static std::complex<T> Swap(const std::complex<T> value) noexcept { return { ByteSwapper<T>::Swap(value.real()), ByteSwapper<T>::Swap(value.imag()) }; }
+		};
+
+		template<typename T>
+		[[maybe_unused]] static T ByteSwap(const T value) noexcept
+		{
+			return ByteSwapper<T>::Swap(value);
+		}
+
+		template<typename T>
+		[[maybe_unused]] static void SwapEndianness(T* buffer, size_t size)
+		{
+			for (size_t i = 0; i < size; i++)
+				buffer[i] = ByteSwap(buffer[i]);
 		}
 
 		template<typename T>
@@ -140,7 +195,7 @@ namespace npypp
 		}
 
 		template<typename T>
-		[[maybe_unused]] MultiDimensionalArray<T> LoadFull(FILE* fp)
+		[[maybe_unused]] MultiDimensionalArray<T> LoadFull(FILE* fp, const uint64_t releaseBehindBytes)
 		{
 			assert(fp != nullptr);
 
@@ -155,8 +210,8 @@ namespace npypp
 			const size_t nElements = std::accumulate(shape.begin(), shape.end(), 1u, std::multiplies<>());
 			data.resize(nElements);
 
-			[[maybe_unused]] const auto charactersRead = fread(data.data(), sizeof(T), nElements, fp);
-			assert(charactersRead == nElements);
+			[[maybe_unused]] const bool read = ReadReleasingBehind(fp, data.data(), nElements * sizeof(T), releaseBehindBytes);
+			assert(read);
 
 			if (endianness != '|' && (endianness != SysEndianness()))
 				SwapEndianness(data);
@@ -179,7 +234,19 @@ namespace npypp
 			const size_t nElements = std::accumulate(shape.begin(), shape.end(), 1u, std::multiplies<>());
 			data.resize(nElements);
 
-			mmf.CopyTo(data);
+			if (mmf.GetOptions().releaseBehindBytes == 0)
+				mmf.CopyTo(data);
+			else
+			{
+				// advance through the mapping, which releases what's behind
+				constexpr size_t chunkElements { (size_t { 1 } << 20) / sizeof(T) };
+				for (size_t i = 0; i < nElements; i += chunkElements)
+				{
+					const size_t n = std::min(chunkElements, nElements - i);
+					mmf.CopyTo(data.data() + i, n);
+					mmf.Advance(n * sizeof(T));
+				}
+			}
 
 			return MultiDimensionalArray<T>(data, shape);
 		}
@@ -203,52 +270,214 @@ namespace npypp
 #pragma region Npz Utilities
 
 		template<typename T>
-		[[maybe_unused]] uint32_t GetCrcNpyFile(const std::string& npyHeader, const std::vector<T>& data)
+		[[maybe_unused]] uint32_t GetCrcNpyFile(const std::string& npyHeader, const std::vector<T>& data, const size_t nThreads)
 		{
-			// NOLINTNEXTLINE
-			const auto crc = crc32(0L, reinterpret_cast<const uint8_t*>(&npyHeader[0]), static_cast<unsigned int>(npyHeader.size()));
+			const auto crc = Crc32(0, npyHeader.data(), npyHeader.size());
+			return ParallelCrc32(crc, data.data(), data.size() * sizeof(T), nThreads);
+		}
 
-			// NOLINTNEXTLINE
-			return static_cast<uint32_t>(crc32(crc, reinterpret_cast<const uint8_t*>(&data[0]), static_cast<unsigned>(data.size() * sizeof(T))));
+		template<typename T>
+		ZipEntry BeginMember(FILE* fp, const uint64_t offset, std::string zipName, const std::vector<size_t>& shape, const CompressionOptions& options)
+		{
+			const size_t nElements = std::accumulate(shape.begin(), shape.end(), size_t { 1 }, std::multiplies<>());
+			const size_t npyHeaderBytes = GetNpyHeader<T>(shape).size();
+
+			ZipEntry entry;
+			entry.name = std::move(zipName);
+			entry.compressionMethod = ToZipCompressionMethod(options.method);
+			entry.localHeaderOffset = offset;
+			entry.zip64 = options.forceZip64 || NeedsZip64(npyHeaderBytes + nElements * sizeof(T));
+			SetAlignmentPadding(entry, npyHeaderBytes, options.alignment);
+
+			// CRC and compressed size are known only once the data has been written: write a placeholder local header, and patch it afterwards
+			const std::string localHeader = GetLocalHeader(entry);
+			WriteBytes(fp, localHeader.data(), localHeader.size());
+
+			return entry;
+		}
+
+		inline void EndMember(FILE* fp, ZipEntry& entry, MemberWriter& memberWriter)
+		{
+			memberWriter.Finish();
+
+			entry.crc = memberWriter.GetCrc();
+			entry.compressedBytes = memberWriter.GetCompressedBytes();
+			entry.uncompressedBytes = memberWriter.GetUncompressedBytes();
+			SetBlockTable(entry, memberWriter.GetBlockBytes(), memberWriter.GetBlockOffsets());
+			const std::string localHeader = GetLocalHeader(entry);
+			if (!Seek(fp, static_cast<int64_t>(entry.localHeaderOffset), SEEK_SET))
+				throw std::runtime_error("cannot write npz member");
+			WriteBytes(fp, localHeader.data(), localHeader.size());
+
+			// the end of the file may be past the end of the member, e.g. when writing over a previous central directory
+			if (!Seek(fp, static_cast<int64_t>(entry.localHeaderOffset + localHeader.size() + entry.compressedBytes), SEEK_SET))
+				throw std::runtime_error("cannot write npz member");
 		}
 
 		template<typename T>
-		MultiDimensionalArray<T> LoadCompressedFull(FILE* fp, uint32_t compressedBytes, uint32_t uncompressedBytes)
+		ZipEntry WriteMember(FILE* fp, const uint64_t offset, std::string zipName, const T* data, const std::vector<size_t>& shape, const CompressionOptions& options)
 		{
-			std::vector<unsigned char> bufferCompressed(compressedBytes);
-			std::vector<unsigned char> bufferUncompressed(uncompressedBytes);
-			size_t UNUSED elementsRead = fread(bufferCompressed.data(), 1, compressedBytes, fp);
-			assert(elementsRead == compressedBytes);
-
-			z_stream stream;
-			stream.zalloc = nullptr;
-			stream.zfree = nullptr;
-			stream.opaque = nullptr;
-			stream.avail_in = 0;
-			stream.next_in = nullptr;
-			inflateInit2(&stream, -MAX_WBITS);
-
-			stream.avail_in = compressedBytes;
-			stream.next_in = bufferCompressed.data();
-			stream.avail_out = uncompressedBytes;
-			stream.next_out = bufferUncompressed.data();
-
-			inflate(&stream, Z_FINISH);
-			inflateEnd(&stream);
+			auto entry = BeginMember<T>(fp, offset, std::move(zipName), shape, options);
+
+			const std::string npyHeader = GetNpyHeader<T>(shape);
+			MemberWriter memberWriter(fp, options);
+			memberWriter.Write(npyHeader.data(), npyHeader.size());
+			memberWriter.Write(data, std::accumulate(shape.begin(), shape.end(), size_t { 1 }, std::multiplies<>()) * sizeof(T));
+			EndMember(fp, entry, memberWriter);
+
+			return entry;
+		}
+
+		template<typename T>
+		MultiDimensionalArray<T> LoadStoredMember(const RandomAccessFile& file, const uint64_t offset, uint32_t* crc, const size_t nThreads)
+		{
+			std::vector<unsigned char> header(npyPreambleSize);
+			if (!file.ReadAt(header.data(), header.size(), offset))
+				throw std::runtime_error("cannot read npy header");
+			header.resize(GetNpyHeaderSize(header.data()));
+			if (!file.ReadAt(header.data() + npyPreambleSize, header.size() - npyPreambleSize, offset + npyPreambleSize))
+				throw std::runtime_error("cannot read npy header");
 
 			std::vector<size_t> shape;
 			size_t wordSize = 0;
 			bool fortranOrder = false;
 			char endianness = 0;
-			detail::ParseNpyHeader(bufferUncompressed, wordSize, shape, fortranOrder, endianness);
+			ParseNpyHeader(header.data(), wordSize, shape, fortranOrder, endianness);
+			assert(wordSize == sizeof(T));
 
 			MultiDimensionalArray<T> array;
-			array.shape = shape;
-			size_t nElements = std::accumulate(shape.begin(), shape.end(), 1u, std::multiplies<>());
+			array.shape = std::move(shape);
+			array.data.resize(std::accumulate(array.shape.begin(), array.shape.end(), size_t { 1 }, std::multiplies<>()));
+			if (!file.ReadAt(array.data.data(), array.data.size() * sizeof(T), offset + header.size()))
+				throw std::runtime_error("cannot read npy data");
+
+			if (crc != nullptr)
+				*crc = ParallelCrc32(Crc32(0, header.data(), header.size()), array.data.data(), array.data.size() * sizeof(T), nThreads);
+
+			if (endianness != '|' && (endianness != SysEndianness()))
+				SwapEndianness(array.data);
+
+			return array;
+		}
+
+		template<typename T>
+		MultiDimensionalArray<T> LoadCompressedFull(const RandomAccessFile& file, const uint64_t offset, uint64_t compressedBytes, uint64_t uncompressedBytes, uint32_t* crc)
+		{
+			MemberReader reader(file, offset, compressedBytes, crc != nullptr);
+			auto array = InflateMember<T>(reader, uncompressedBytes);
+			if (crc != nullptr)
+				*crc = reader.GetCrc();
+
+			return array;
+		}
+
+		template<typename T>
+		MultiDimensionalArray<T> LoadCompressedBlocks(const RandomAccessFile& file, const uint64_t offset, const uint64_t compressedBytes, const uint64_t uncompressedBytes,
+													  const uint64_t blockBytes, const std::vector<uint64_t>& blockOffsets, uint32_t* crc, const size_t nThreads)
+		{
+			// the npy header, at the start of the first block, gives the size of the array
+			std::vector<unsigned char> header(npyPreambleSize);
+			{
+				MemberReader reader(file, offset, compressedBytes);
+				reader.Read(header.data(), header.size());
+				header.resize(GetNpyHeaderSize(header.data()));
+				reader.Read(header.data() + npyPreambleSize, header.size() - npyPreambleSize);
+			}
+
+			std::vector<size_t> shape;
+			size_t wordSize = 0;
+			bool fortranOrder = false;
+			char endianness = 0;
+			ParseNpyHeader(header.data(), wordSize, shape, fortranOrder, endianness);
+			assert(wordSize == sizeof(T));
+
+			MultiDimensionalArray<T> array;
+			array.shape = std::move(shape);
+			const size_t nElements = std::accumulate(array.shape.begin(), array.shape.end(), size_t { 1 }, std::multiplies<>());
+			if (header.size() + nElements * sizeof(T) != uncompressedBytes)
+				throw std::runtime_error("npy header inconsistent with the member size");
+			if (blockBytes == 0 || blockOffsets.size() >= (uncompressedBytes + blockBytes - 1) / blockBytes)
+				throw std::runtime_error("invalid block table");
 			array.data.resize(nElements);
-			size_t nElementsInBytes = nElements * sizeof(T);
-			size_t offset = uncompressedBytes - nElementsInBytes;
-			std::memcpy(array.data.data(), bufferUncompressed.data() + offset, nElementsInBytes);
+
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			auto* data = reinterpret_cast<unsigned char*>(array.data.data());
+			const size_t nBlocks = blockOffsets.size() + 1;
+			std::vector<uint32_t> blockCrcs(nBlocks);
+			ParallelFor(nBlocks, nThreads,
+						[&](const size_t i)
+						{
+							InflateCheckpoint checkpoint;
+							checkpoint.compressedOffset = i == 0 ? 0 : blockOffsets[i - 1];
+							checkpoint.uncompressedOffset = i * blockBytes;
+							if (checkpoint.compressedOffset > compressedBytes)
+								throw std::runtime_error("invalid block table");
+							MemberReader reader(file, offset, compressedBytes, checkpoint, crc != nullptr);
+
+							// the header is read again by the first block, for its CRC
+							uint64_t begin = checkpoint.uncompressedOffset;
+							const uint64_t end = std::min(begin + blockBytes, uncompressedBytes);
+							if (begin < header.size())
+							{
+								std::vector<unsigned char> blockHeader(static_cast<size_t>(std::min<uint64_t>(header.size(), end) - begin));
+								reader.Read(blockHeader.data(), blockHeader.size());
+								begin += blockHeader.size();
+							}
+							reader.Read(data + (begin - header.size()), end - begin);
+							if (i == nBlocks - 1)
+								reader.Finish();
+							blockCrcs[i] = reader.GetCrc();
+						});
+
+			if (crc != nullptr)
+			{
+				*crc = blockCrcs[0];
+				for (size_t i = 1; i < nBlocks; ++i)
+					*crc = Crc32Combine(*crc, blockCrcs[i], std::min<uint64_t>(blockBytes, uncompressedBytes - i * blockBytes));
+			}
+
+			if (endianness != '|' && (endianness != SysEndianness()))
+				SwapEndianness(array.data);
+
+			return array;
+		}
+
+		template<typename T>
+		MultiDimensionalArray<T> InflateMember(const unsigned char* bufferCompressed, uint64_t compressedBytes, uint64_t uncompressedBytes, uint32_t* crc)
+		{
+			MemberReader reader(bufferCompressed, compressedBytes, crc != nullptr);
+			auto array = InflateMember<T>(reader, uncompressedBytes);
+			if (crc != nullptr)
+				*crc = reader.GetCrc();
+
+			return array;
+		}
+
+		template<typename T>
+		MultiDimensionalArray<T> InflateMember(MemberReader& reader, uint64_t uncompressedBytes)
+		{
+			// the npy header is parsed out of the first inflated bytes, which gives the size of the array to inflate the rest into
+			std::vector<unsigned char> header(npyPreambleSize);
+			reader.Read(header.data(), header.size());
+			header.resize(GetNpyHeaderSize(header.data()));
+			reader.Read(header.data() + npyPreambleSize, header.size() - npyPreambleSize);
+
+			std::vector<size_t> shape;
+			size_t wordSize = 0;
+			bool fortranOrder = false;
+			char endianness = 0;
+			ParseNpyHeader(header.data(), wordSize, shape, fortranOrder, endianness);
+			assert(wordSize == sizeof(T));
+
+			MultiDimensionalArray<T> array;
+			array.shape = std::move(shape);
+			const size_t nElements = std::accumulate(array.shape.begin(), array.shape.end(), size_t { 1 }, std::multiplies<>());
+			if (header.size() + nElements * sizeof(T) != uncompressedBytes)
+				throw std::runtime_error("npy header inconsistent with the member size");
+
+			array.data.resize(nElements);
+			reader.Read(array.data.data(), nElements * sizeof(T));
+			reader.Finish();
 
 			if (endianness != '|' && (endianness != SysEndianness()))
 				SwapEndianness(array.data);
@@ -325,23 +554,104 @@ namespace npypp
 	 * Load the full info (data and shape) from the file
 	 */
 	template<typename T>
-	MultiDimensionalArray<T> LoadFull(const std::string& fileName, const bool useMemoryMap)
+	MultiDimensionalArray<T> LoadFull(const std::string& fileName, const bool useMemoryMap, const uint64_t releaseBehindBytes)
 	{
 		if (!useMemoryMap)
 		{
 			FILE* fp = nullptr;
 			FOPEN(fp, fileName.c_str(), "rb");
-			const auto ret = detail::LoadFull<T>(fp);
+			const auto ret = detail::LoadFull<T>(fp, releaseBehindBytes);
 			fclose(fp);
 
 			return ret;
 		}
 
-		mm::MemoryMappedFile<mm::CacheHint::SequentialScan, mm::MapMode::ReadOnly> mmf(fileName);
+		mm::MapOptions options;
+		options.releaseBehindBytes = static_cast<size_t>(releaseBehindBytes);
+		mm::MemoryMappedFile<mm::CacheHint::SequentialScan, mm::MapMode::ReadOnly> mmf(fileName, 0, options);
 		assert(mmf.IsValid());
 		return detail::LoadFull<T, mm::CacheHint::SequentialScan>(mmf);
 	}
 
+	template<typename T, typename Allocator>
+	std::vector<size_t> LoadInto(const std::string& fileName, std::vector<T, Allocator>& data, const uint64_t releaseBehindBytes)
+	{
+		FILE* fp = nullptr;
+		FOPEN(fp, fileName.c_str(), "rb");
+		if (fp == nullptr)
+			throw std::runtime_error("cannot open " + fileName);
+		std::unique_ptr<FILE, int (*)(FILE*)> file(fp, fclose);
+
+		std::vector<size_t> shape;
+		size_t wordSize = 0;
+		bool fortranOrder = false;
+		char endianness = 0;
+		detail::ParseNpyHeader(fp, wordSize, shape, fortranOrder, endianness);
+		if (wordSize != sizeof(T))
+			throw std::runtime_error("word size mismatch in " + fileName);
+
+		const size_t nElements = std::accumulate(shape.begin(), shape.end(), size_t { 1 }, std::multiplies<>());
+		data.resize(nElements);
+		if (!detail::ReadReleasingBehind(fp, data.data(), nElements * sizeof(T), releaseBehindBytes))
+			throw std::runtime_error("truncated array data in " + fileName);
+
+		if (endianness != '|' && (endianness != detail::SysEndianness()))
+			detail::SwapEndianness(data.data(), data.size());
+
+		return shape;
+	}
+
+	template<typename T>
+	MultiDimensionalArray<T, mm::NumaAllocator<T>> LoadFull(const std::string& fileName, const mm::NumaPolicy& policy)
+	{
+		const detail::RandomAccessFile file(fileName);
+		if (!file.IsValid())
+			throw std::runtime_error("cannot open " + fileName);
+
+		std::vector<unsigned char> header(detail::npyPreambleSize);
+		if (!file.ReadAt(header.data(), header.size(), 0))
+			throw std::runtime_error("cannot read npy header of " + fileName);
+		header.resize(detail::GetNpyHeaderSize(header.data()));
+		if (!file.ReadAt(header.data() + detail::npyPreambleSize, header.size() - detail::npyPreambleSize, detail::npyPreambleSize))
+			throw std::runtime_error("cannot read npy header of " + fileName);
+
+		MultiDimensionalArray<T, mm::NumaAllocator<T>> array;
+		size_t wordSize = 0;
+		bool fortranOrder = false;
+		char endianness = 0;
+		detail::ParseNpyHeader(header.data(), wordSize, array.shape, fortranOrder, endianness);
+		if (wordSize != sizeof(T))
+			throw std::runtime_error("word size mismatch in " + fileName);
+
+		// resizing doesn't touch the pages: they're placed before the reading threads fault them in.
+		// With a single node, there's nothing to place them on
+		const size_t nElements = std::accumulate(array.shape.begin(), array.shape.end(), size_t { 1 }, std::multiplies<>());
+		const size_t nBytes = nElements * sizeof(T);
+		const size_t rowBytes = array.shape.empty() || array.shape.front() == 0 ? sizeof(T) : nBytes / array.shape.front();
+		std::vector<T, mm::NumaAllocator<T>> data { mm::NumaAllocator<T>(mm::detail::LeaveUninitialized {}) };
+		data.resize(nElements);
+		if (!mm::ApplyNumaPolicy(data.data(), nBytes, policy, rowBytes) && mm::NumaNodes().size() > 1)
+			throw std::runtime_error("cannot apply the NUMA policy to " + fileName);
+
+		const size_t nParts = policy.placement == mm::NumaPlacement::Partition ? policy.GetNodes().size() : 1;
+		const bool swap = endianness != '|' && endianness != detail::SysEndianness();
+		detail::ParallelFor(nParts, nParts,
+							[&](const size_t i)
+							{
+								const mm::ThreadNumaScope numaScope(policy, i);
+								const size_t begin = mm::NumaPartBegin(nBytes, nParts, rowBytes, i);
+								const size_t end = mm::NumaPartBegin(nBytes, nParts, rowBytes, i + 1);
+								if (!file.ReadAt(data.data() + begin / sizeof(T), end - begin, header.size() + begin))
+									throw std::runtime_error("truncated array data in " + fileName);
+								if (swap)
+									detail::SwapEndianness(data.data() + begin / sizeof(T), (end - begin) / sizeof(T));
+							});
+
+		// the allocators compare equal: the buffer is moved, into a vector initializing its elements as any other
+		array.data = std::vector<T, mm::NumaAllocator<T>>(std::move(data), mm::NumaAllocator<T>());
+		return array;
+	}
+
 	/**
 	 * Load the full info (data and shape) from the file using an externally set memory mapped file without copying memory
 	 */
@@ -355,135 +665,4 @@ namespace npypp
 
 #pragma endregion
 
-#pragma region Load / Save Npz
-
-	template<typename T>
-	void SaveCompressed(const std::string& zipFileName, std::string vectorName, const std::vector<T>& data, const std::vector<size_t>& shape, const std::string& mode)
-	{
-		// first, append a .npy to the vector name, since the .npz file stores multiple npy files
-		vectorName += ".npy";
-
-		// now, on with the show
-		FILE* fp = nullptr;
-		uint16_t nRecords = 0;
-		size_t globalHeaderOffset = 0;
-		std::string globalHeader;
-
-		if (mode == "a")
-			FOPEN(fp, zipFileName.c_str(), "r+b");
-
-		if (fp)
-		{
-			// zip file exists. we need to add a new npy file to it
-
-			// read the footer. this gives us the offset and size of the global header
-			size_t globalHeaderSize;
-			detail::ParseNpzFooter(fp, nRecords, globalHeaderSize, globalHeaderOffset);
-			globalHeader.resize(globalHeaderSize);
-			fseek(fp, static_cast<long>(globalHeaderOffset), SEEK_SET);
-
-			// read and store the global header.
-			const size_t UNUSED elementsRead = fread(&globalHeader[0], sizeof(char), globalHeaderSize, fp);
-			assert(elementsRead == globalHeaderSize);
-
-			// below, we will write the the new data at the start of the global header then append the global header and footer below it
-			fseek(fp, static_cast<long>(globalHeaderOffset), SEEK_SET);
-		}
-		else
-			FOPEN(fp, zipFileName.c_str(), "wb");
-		assert(fp != nullptr);
-
-		const std::string npyHeader = detail::GetNpyHeader<T>(shape);
-
-		const size_t nElements = std::accumulate(shape.begin(), shape.end(), 1u, std::multiplies<>());
-		const size_t nElementsInBytes = nElements * sizeof(T);
-		size_t totalNpyFileBytes = nElementsInBytes + npyHeader.size();
-
-		// get the CRC of the data to be added
-		uint32_t crc = detail::GetCrcNpyFile(npyHeader, data);
-
-		// get Npz info
-		std::string localHeader = detail::GetLocalHeader(crc, static_cast<uint32_t>(totalNpyFileBytes), vectorName);
-		detail::AppendGlobalHeader(globalHeader, localHeader, static_cast<uint32_t>(globalHeaderOffset), vectorName);
-		std::string footer = detail::GetNpzFooter(globalHeader, static_cast<uint32_t>(globalHeaderOffset), static_cast<uint32_t>(localHeader.size()), static_cast<uint32_t>(totalNpyFileBytes),
-												  static_cast<uint16_t>(nRecords + 1));
-
-		// write
-		[[maybe_unused]] size_t elementsWritten = fwrite(localHeader.data(), sizeof(char), localHeader.size(), fp);
-		assert(elementsWritten == localHeader.size());
-
-		elementsWritten = fwrite(npyHeader.data(), sizeof(char), npyHeader.size(), fp);
-		assert(elementsWritten == npyHeader.size());
-
-		elementsWritten = fwrite(data.data(), sizeof(T), nElements, fp);
-		assert(elementsWritten == nElements);
-
-		elementsWritten = fwrite(globalHeader.data(), sizeof(char), globalHeader.size(), fp);
-		assert(elementsWritten == globalHeader.size());
-
-		elementsWritten = fwrite(footer.data(), sizeof(char), footer.size(), fp);
-		assert(elementsWritten == footer.size());
-
-		std::fclose(fp);
-	}
-
-	template<typename T>
-	CompressedMapFull<T> LoadCompressedFull(const std::string& zipFileName)
-	{
-		FILE* fp = nullptr;
-		FOPEN(fp, zipFileName.c_str(), "rb");
-		assert(fp != nullptr);
-
-		CompressedMapFull<T> ret;
-
-		while (true)
-		{
-			constexpr size_t localHeaderSize { 30 };
-			std::array<char, localHeaderSize> localHeader {};
-			UNUSED_ON_NDEBUG(size_t elementsRead =) fread(localHeader.data(), sizeof(char), localHeaderSize, fp);
-			assert(elementsRead == localHeaderSize);
-
-			// if we've reached the global header, stop reading
-			if (localHeader[2] != 0x03 || localHeader[3] != 0x04)
-				break;
-
-			// read in the variable name
-			uint16_t vectorNameLength = 0;
-			std::memcpy(&vectorNameLength, &localHeader[26], sizeof(vectorNameLength));
-			std::string vectorName(vectorNameLength, ' ');
-			UNUSED_ON_NDEBUG(elementsRead =) fread(vectorName.data(), sizeof(char), vectorNameLength, fp);
-			assert(elementsRead == vectorNameLength);
-
-			// remove the extenstion (i.e. ".npy")
-			vectorName.erase(vectorName.end() - 4, vectorName.end());
-
-			// read in the extra field
-			uint16_t extraFieldsLength = 0;
-			std::memcpy(&extraFieldsLength, &localHeader[28], sizeof(extraFieldsLength));
-			if (extraFieldsLength > 0)
-			{
-				std::string tmp(extraFieldsLength, ' ');
-				UNUSED_ON_NDEBUG(elementsRead =) fread(tmp.data(), sizeof(char), extraFieldsLength, fp);
-				assert(elementsRead == extraFieldsLength);
-			}
-
-			uint16_t compressionMethod = 0;
-			std::memcpy(&compressionMethod, &localHeader[8], sizeof(compressionMethod));
-			uint32_t compressedBytes = 0;
-			std::memcpy(&compressedBytes, &localHeader[18], sizeof(compressedBytes));
-			uint32_t uncompressedBytes = 0;
-			std::memcpy(&uncompressedBytes, &localHeader[22], sizeof(uncompressedBytes));
-
-			if (compressionMethod == 0)
-				ret[vectorName] = detail::LoadFull<T>(fp);
-			else
-				ret[vectorName] = detail::LoadCompressedFull<T>(fp, compressedBytes, uncompressedBytes);
-		}
-
-		std::fclose(fp);
-
-		return ret;
-	}
-
-#pragma endregion
 }	 // namespace npypp
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <Npy++.h>
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace npypp
+{
+	/// a member of an *.npz archive, as recorded in its central directory
+	struct NpzMemberInfo
+	{
+		std::string name {};	///< without the ".npy" extension
+		uint16_t flags = 0;
+		uint16_t compressionMethod = 0;	   ///< 0: stored, 8: deflate
+		uint32_t crc = 0;
+		uint64_t compressedBytes = 0;
+		uint64_t uncompressedBytes = 0;
+		uint64_t localHeaderOffset = 0;
+		/// independently decodable blocks (see CompressionOptions::fullFlushBytes): uncompressed size, and compressed offsets of the blocks after the first
+		uint64_t blockBytes = 0;
+		std::vector<uint64_t> blockOffsets {};
+
+		[[nodiscard]] bool IsStored() const noexcept { return compressionMethod == 0; }
+	};
+
+	namespace detail
+	{
+		/// checkpoints for random access into a deflated member, and the central directory record they were built from
+		struct AccessIndex
+		{
+			NpzMemberInfo member {};
+			uint64_t checkpointBytes = 0;
+			std::vector<InflateCheckpoint> checkpoints {};
+
+			/// the index is stale if the member was rewritten or moved, and doesn't fit if it was built with another checkpoint spacing
+			[[nodiscard]] bool Matches(const NpzMemberInfo& info, const uint64_t checkpointBytes_) const noexcept
+			{
+				return member.name == info.name && member.crc == info.crc && member.compressedBytes == info.compressedBytes && member.uncompressedBytes == info.uncompressedBytes
+					   && member.localHeaderOffset == info.localHeaderOffset && checkpointBytes == checkpointBytes_;
+			}
+
+			/// the last checkpoint at or before uncompressedOffset, nullptr if there's none
+			[[nodiscard]] const InflateCheckpoint* Find(uint64_t uncompressedOffset) const noexcept;
+		};
+
+		/// the sidecar file is written atomically, with a trailing CRC, and ignored if it can't be read back or is corrupt
+		void SaveAccessIndices(const std::string& fileName, const std::vector<std::shared_ptr<const AccessIndex>>& indices);
+		[[nodiscard]] std::vector<std::shared_ptr<const AccessIndex>> LoadAccessIndices(const std::string& fileName);
+	}	 // namespace detail
+
+	/// index of the members of an *.npz file by name, built from its central directory
+	class NpzDirectory
+	{
+	public:
+		[[nodiscard]] size_t size() const noexcept { return _members.size(); }
+
+		/// member names, in archive order
+		[[nodiscard]] std::vector<std::string> Names() const;
+
+		[[nodiscard]] bool Contains(const std::string& name) const noexcept { return _index.find(name) != _index.end(); }
+
+		/// throws std::out_of_range if there's no such member
+		[[nodiscard]] const NpzMemberInfo& Info(const std::string& name) const { return _members[_index.at(name)]; }
+
+		[[nodiscard]] const std::vector<NpzMemberInfo>& Members() const noexcept { return _members; }
+
+		/// names of the members matching a shell-style wildcard pattern ('*' and '?'), in archive order
+		[[nodiscard]] std::vector<std::string> Glob(const std::string& pattern) const;
+
+		/// names of the members for which predicate(const NpzMemberInfo&) is true, in archive order
+		template<typename Predicate>
+		[[nodiscard]] std::vector<std::string> Select(Predicate&& predicate) const;
+
+	protected:
+		/// (re)index the central directory records, stripping the ".npy" extension off the names
+		void Index(std::vector<detail::ZipEntry>&& entries);
+
+		/// the central directory records, in the same order as Members()
+		[[nodiscard]] const std::vector<detail::ZipEntry>& Entries() const noexcept { return _entries; }
+
+	private:
+		std::vector<detail::ZipEntry> _entries {};
+		std::vector<NpzMemberInfo> _members {};
+		std::unordered_map<std::string, size_t> _index {};
+	};
+
+	/**
+	 * Random access to the members of an *.npz file.
+	 * Only the end of central directory record and the central directory are read on construction, and indexed by member name:
+	 * members are then read (and inflated) on demand, so that loading one array doesn't cost more than reading that array.
+	 * The file is kept open for the lifetime of the archive, and read with positional reads: loading members is thread-safe.
+	 * Sizes and CRCs are taken from the central directory only, so members written by streaming zip writers, with zeros in their local
+	 * header and a trailing data descriptor (flag bit 3), are read as any other.
+	 * Deflated members with a table of independently decodable blocks are inflated on NpzLoadOptions::nThreads threads
+	 */
+	class NpzArchive: public NpzDirectory
+	{
+	public:
+		/// throws std::runtime_error if the file can't be opened, or isn't a zip archive
+		explicit NpzArchive(const std::string& fileName);
+
+		[[nodiscard]] const std::string& GetFileName() const noexcept { return _fileName; }
+
+		/// read a single member, throws std::out_of_range if there's no such member
+		template<typename T>
+		[[nodiscard]] MultiDimensionalArray<T> Load(const std::string& name, const NpzLoadOptions& options = {}) const;
+
+		/// members are read and inflated concurrently, on up to options.nThreads threads
+		template<typename T>
+		[[nodiscard]] CompressedMapFull<T> Load(const std::vector<std::string>& names, const NpzLoadOptions& options = {}) const;
+
+		template<typename T>
+		[[nodiscard]] CompressedMapFull<T> LoadAll(const NpzLoadOptions& options = {}) const
+		{
+			return Load<T>(Names(), options);
+		}
+
+		/**
+		 * Rows [firstRow, firstRow + nRows) of a member, i.e. a range along its first axis, which must be in C order.
+		 * Stored members are read in place; deflated ones are inflated from the nearest checkpoint of their access index, if
+		 * options.checkpointBytes isn't 0, which turns reading a range of a foreign archive from O(member) into O(range).
+		 * Members with independently decodable blocks are inflated from the block holding the first row, without index.
+		 * The CRC is verified (if options.verifyCrc) only when building the access index, as otherwise only part of the member is read.
+		 * Throws std::out_of_range if the rows are past the end
+		 */
+		template<typename T>
+		[[nodiscard]] MultiDimensionalArray<T> LoadRows(const std::string& name, size_t firstRow, size_t nRows, const NpzLoadOptions& options = {}) const;
+
+		/// the access index LoadRows uses for a deflated member (see options.checkpointBytes), loaded from options.indexFileName or built there
+		[[nodiscard]] std::shared_ptr<const detail::AccessIndex> GetAccessIndex(const std::string& name, const NpzLoadOptions& options) const
+		{
+			const auto& info = Info(name);
+			return GetAccessIndex(info, GetDataOffset(info), options);
+		}
+
+		/// offset in the file of the member's data (i.e. its npy header), right after its local header
+		[[nodiscard]] uint64_t GetDataOffset(const NpzMemberInfo& info) const;
+
+		/// alignment of the array data recorded in the member's local header (see CompressionOptions::alignment), 0 if it has none
+		[[nodiscard]] uint16_t GetAlignment(const NpzMemberInfo& info) const { return GetAlignment(info, GetDataOffset(info)); }
+
+		/**
+		 * Write a new version of the member after the last one, and point the central directory to it, rewriting it in place.
+		 * Duplicates of the member are dropped from the central directory. The member is added if it's not in the archive.
+		 * The previous data is left in the file, as unreferenced bytes, until Compact()
+		 */
+		template<typename T>
+		void Replace(const std::string& name, const std::vector<T>& data, const std::vector<size_t>& shape, const CompressionOptions& options = {});
+
+		template<typename T>
+		void Replace(const std::string& name, const MultiDimensionalArray<T>& array, const CompressionOptions& options = {})
+		{
+			Replace(name, array.data, array.shape, options);
+		}
+
+		/// drop the member (and its duplicates) from the central directory, rewriting it in place. Returns false if there's no such member
+		bool Remove(const std::string& name);
+
+		/// bytes of member data no longer referenced by the central directory, i.e. what Compact() would reclaim
+		[[nodiscard]] uint64_t GetUnreferencedBytes() const;
+
+		/**
+		 * Repack the referenced members into a new file, which then atomically replaces the archive. Aligned stored members are kept aligned.
+		 * Member data is copied with copy_file_range where available, so that it doesn't go through user space
+		 */
+		void Compact();
+
+		// Replace, Remove and Compact must not run concurrently with anything else on the archive
+
+	private:
+		[[nodiscard]] uint16_t GetAlignment(const NpzMemberInfo& info, uint64_t dataOffset) const;
+
+		/// the member's access index, loaded from options.indexFileName or built (and saved there) on first access
+		[[nodiscard]] std::shared_ptr<const detail::AccessIndex> GetAccessIndex(const NpzMemberInfo& info, uint64_t dataOffset, const NpzLoadOptions& options) const;
+
+		/// write the central directory of entries at offset, followed by the footer, and truncate the file there
+		void WriteCentralDirectory(FILE* fp, std::vector<detail::ZipEntry>&& entries, uint64_t offset);
+
+		/// open the archive for writing, for in place updates
+		[[nodiscard]] std::unique_ptr<FILE, int (*)(FILE*)> OpenForUpdate() const;
+
+		std::string _fileName;
+		detail::RandomAccessFile _file;
+		/// where the central directory starts, i.e. the end of the members' data
+		uint64_t _globalHeaderOffset = 0;
+
+		/// access indices of the deflated members read by LoadRows, by name. Stale ones are rebuilt when the member changes
+		mutable std::unique_ptr<std::mutex> _accessIndicesMutex = std::make_unique<std::mutex>();
+		mutable std::unordered_map<std::string, std::shared_ptr<const detail::AccessIndex>> _accessIndices {};
+		mutable bool _accessIndicesLoaded = false;
+	};
+}	 // namespace npypp
+
+#include <NpzArchive.tpp>
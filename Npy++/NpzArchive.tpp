@@ -0,0 +1,533 @@
+#pragma once
+
+namespace npypp
+{
+	inline NpzArchive::NpzArchive(const std::string& fileName) : _fileName(fileName), _file(fileName)
+	{
+		if (!_file.IsValid())
+			throw std::runtime_error("cannot open " + fileName);
+
+		uint64_t nRecords = 0;
+		uint64_t globalHeaderSize = 0;
+		detail::ParseNpzFooter(_file, nRecords, globalHeaderSize, _globalHeaderOffset);
+
+		std::string globalHeader(globalHeaderSize, ' ');
+		if (!_file.ReadAt(globalHeader.data(), globalHeader.size(), _globalHeaderOffset))
+			throw std::runtime_error("truncated central directory in " + fileName);
+
+		auto entries = detail::ParseCentralDirectory(globalHeader.data(), globalHeader.size());
+		assert(entries.size() == nRecords);
+		Index(std::move(entries));
+	}
+
+	inline void NpzDirectory::Index(std::vector<detail::ZipEntry>&& entries)
+	{
+		_entries = std::move(entries);
+		_members.clear();
+		_index.clear();
+		_members.reserve(_entries.size());
+		_index.reserve(_entries.size());
+		for (const auto& entry : _entries)
+		{
+			NpzMemberInfo info;
+			info.name = entry.name;
+			// remove the extension (i.e. ".npy")
+			if (info.name.size() >= 4 && info.name.compare(info.name.size() - 4, 4, ".npy") == 0)
+				info.name.erase(info.name.size() - 4);
+			info.flags = entry.flags;
+			info.compressionMethod = entry.compressionMethod;
+			info.crc = entry.crc;
+			info.compressedBytes = entry.compressedBytes;
+			info.uncompressedBytes = entry.uncompressedBytes;
+			info.localHeaderOffset = entry.localHeaderOffset;
+			info.blockBytes = entry.blockBytes;
+			info.blockOffsets = entry.blockOffsets;
+
+			// as with numpy, a later member shadows an earlier one with the same name
+			_index[info.name] = _members.size();
+			_members.push_back(std::move(info));
+		}
+	}
+
+	inline std::vector<std::string> NpzDirectory::Names() const
+	{
+		return Select([](const NpzMemberInfo&) { return true; });
+	}
+
+	inline std::vector<std::string> NpzDirectory::Glob(const std::string& pattern) const
+	{
+		return Select([&pattern](const NpzMemberInfo& info) { return utils::GlobMatch(pattern, info.name); });
+	}
+
+	template<typename Predicate>
+	std::vector<std::string> NpzDirectory::Select(Predicate&& predicate) const
+	{
+		std::vector<std::string> ret;
+		for (const auto& info : _members)
+			if (predicate(info))
+				ret.push_back(info.name);
+		return ret;
+	}
+
+	inline uint64_t NpzArchive::GetDataOffset(const NpzMemberInfo& info) const
+	{
+		std::array<char, detail::localHeaderSize> localHeader {};
+		if (!_file.ReadAt(localHeader.data(), localHeader.size(), info.localHeaderOffset) || detail::readBytes<uint32_t>(localHeader.data()) != 0x04034b50)
+			throw std::runtime_error("invalid local header for member '" + info.name + "' of " + _fileName);
+
+		// the local header's extra fields may differ from the central directory ones
+		const auto nameLength = detail::readBytes<uint16_t>(&localHeader[26]);
+		const auto extraFieldsLength = detail::readBytes<uint16_t>(&localHeader[28]);
+		return info.localHeaderOffset + detail::localHeaderSize + nameLength + extraFieldsLength;
+	}
+
+	inline uint16_t NpzArchive::GetAlignment(const NpzMemberInfo& info, const uint64_t dataOffset) const
+	{
+		std::string localHeader(dataOffset - info.localHeaderOffset, ' ');
+		if (!_file.ReadAt(localHeader.data(), localHeader.size(), info.localHeaderOffset))
+			throw std::runtime_error("invalid local header for member '" + info.name + "' of " + _fileName);
+
+		const size_t extraFieldsOffset = detail::localHeaderSize + detail::readBytes<uint16_t>(&localHeader[26]);
+		return detail::ParseAlignmentExtraField(localHeader.data() + extraFieldsOffset, localHeader.size() - extraFieldsOffset);
+	}
+
+	template<typename T>
+	MultiDimensionalArray<T> NpzArchive::Load(const std::string& name, const NpzLoadOptions& options) const
+	{
+		const auto& info = Info(name);
+		const uint64_t dataOffset = GetDataOffset(info);
+
+		// sizes and CRC come from the central directory, which is authoritative
+		uint32_t crc = 0;
+		uint32_t* crcPtr = options.verifyCrc ? &crc : nullptr;
+		MultiDimensionalArray<T> ret;
+		if (info.IsStored())
+			ret = detail::LoadStoredMember<T>(_file, dataOffset, crcPtr, options.nThreads);
+		else if (!info.blockOffsets.empty() && options.nThreads != 1)
+			ret = detail::LoadCompressedBlocks<T>(_file, dataOffset, info.compressedBytes, info.uncompressedBytes, info.blockBytes, info.blockOffsets, crcPtr, options.nThreads);
+		else
+			ret = detail::LoadCompressedFull<T>(_file, dataOffset, info.compressedBytes, info.uncompressedBytes, crcPtr);
+
+		if (options.verifyCrc && crc != info.crc)
+			throw std::runtime_error("CRC mismatch for member '" + name + "' of " + _fileName);
+
+		return ret;
+	}
+
+	template<typename T>
+	CompressedMapFull<T> NpzArchive::Load(const std::vector<std::string>& names, const NpzLoadOptions& options) const
+	{
+		// members are the unit of parallelism: each one is loaded on a single thread
+		const size_t nThreads = std::min(detail::GetNumberOfThreads(options.nThreads), names.size());
+		NpzLoadOptions memberOptions = options;
+		if (nThreads > 1)
+			memberOptions.nThreads = 1;
+
+		std::vector<MultiDimensionalArray<T>> arrays(names.size());
+		detail::ParallelFor(names.size(), nThreads, [&](const size_t i) { arrays[i] = Load<T>(names[i], memberOptions); });
+
+		CompressedMapFull<T> ret;
+		for (size_t i = 0; i < names.size(); ++i)
+			ret[names[i]] = std::move(arrays[i]);
+		return ret;
+	}
+
+	template<typename T>
+	MultiDimensionalArray<T> NpzArchive::LoadRows(const std::string& name, const size_t firstRow, const size_t nRows, const NpzLoadOptions& options) const
+	{
+		const auto& info = Info(name);
+		const uint64_t dataOffset = GetDataOffset(info);
+
+		// stored members are read at any offset, deflated ones sequentially
+		std::unique_ptr<detail::MemberReader> reader;
+		if (!info.IsStored())
+			reader = std::make_unique<detail::MemberReader>(_file, dataOffset, info.compressedBytes);
+		const auto read = [&](void* out, const uint64_t nBytes, const uint64_t offset)
+		{
+			if (reader)
+				reader->Read(out, nBytes);
+			else if (!_file.ReadAt(out, nBytes, dataOffset + offset))
+				throw std::runtime_error("cannot read member '" + name + "' of " + _fileName);
+		};
+
+		std::vector<unsigned char> header(detail::npyPreambleSize);
+		read(header.data(), header.size(), 0);
+		header.resize(detail::GetNpyHeaderSize(header.data()));
+		read(header.data() + detail::npyPreambleSize, header.size() - detail::npyPreambleSize, detail::npyPreambleSize);
+
+		std::vector<size_t> shape;
+		size_t wordSize = 0;
+		bool fortranOrder = false;
+		char endianness = 0;
+		detail::ParseNpyHeader(header.data(), wordSize, shape, fortranOrder, endianness);
+		assert(wordSize == sizeof(T));
+		if (fortranOrder || shape.empty())
+			throw std::runtime_error("member '" + name + "' of " + _fileName + " has no rows");
+		if (firstRow > shape[0] || nRows > shape[0] - firstRow)
+			throw std::out_of_range("rows past the end of member '" + name + "' of " + _fileName);
+
+		MultiDimensionalArray<T> array;
+		array.shape = shape;
+		array.shape[0] = nRows;
+		const size_t rowElements = std::accumulate(shape.begin() + 1, shape.end(), size_t { 1 }, std::multiplies<>());
+		array.data.resize(nRows * rowElements);
+		const uint64_t offset = header.size() + uint64_t { firstRow } * rowElements * sizeof(T);
+
+		if (reader)
+		{
+			// independently decodable blocks don't need an index
+			std::shared_ptr<const detail::AccessIndex> index;
+			detail::InflateCheckpoint blockStart;
+			const detail::InflateCheckpoint* checkpoint = nullptr;
+			if (offset >= info.blockBytes && !info.blockOffsets.empty())
+			{
+				const auto block = static_cast<size_t>(std::min<uint64_t>(offset / info.blockBytes, info.blockOffsets.size()));
+				blockStart.compressedOffset = info.blockOffsets[block - 1];
+				blockStart.uncompressedOffset = block * info.blockBytes;
+				checkpoint = &blockStart;
+			}
+			else if (info.blockOffsets.empty() && options.checkpointBytes > 0)
+			{
+				index = GetAccessIndex(info, dataOffset, options);
+				checkpoint = index->Find(offset);
+			}
+
+			if (checkpoint != nullptr && checkpoint->uncompressedOffset > header.size())
+			{
+				reader = std::make_unique<detail::MemberReader>(_file, dataOffset, info.compressedBytes, *checkpoint);
+				reader->Skip(offset - checkpoint->uncompressedOffset);
+			}
+			else
+				reader->Skip(offset - header.size());
+		}
+		read(array.data.data(), array.data.size() * sizeof(T), offset);
+
+		if (endianness != '|' && (endianness != detail::SysEndianness()))
+			detail::SwapEndianness(array.data);
+
+		return array;
+	}
+
+	inline std::shared_ptr<const detail::AccessIndex> NpzArchive::GetAccessIndex(const NpzMemberInfo& info, const uint64_t dataOffset, const NpzLoadOptions& options) const
+	{
+		{
+			std::lock_guard<std::mutex> lock(*_accessIndicesMutex);
+			if (!_accessIndicesLoaded && !options.indexFileName.empty())
+			{
+				for (auto& index : detail::LoadAccessIndices(options.indexFileName))
+					_accessIndices[index->member.name] = std::move(index);
+				_accessIndicesLoaded = true;
+			}
+
+			const auto iter = _accessIndices.find(info.name);
+			if (iter != _accessIndices.end() && iter->second->Matches(info, options.checkpointBytes))
+				return iter->second;
+		}
+
+		// built without holding the lock, so that indexing a member doesn't hold up reading others
+		auto index = std::make_shared<detail::AccessIndex>();
+		index->member = info;
+		index->checkpointBytes = options.checkpointBytes;
+		detail::MemberReader reader(_file, dataOffset, info.compressedBytes, options.verifyCrc);
+		index->checkpoints = reader.Index(options.checkpointBytes);
+		if (options.verifyCrc && reader.GetCrc() != info.crc)
+			throw std::runtime_error("CRC mismatch for member '" + info.name + "' of " + _fileName);
+
+		std::lock_guard<std::mutex> lock(*_accessIndicesMutex);
+		_accessIndices[info.name] = index;
+		if (!options.indexFileName.empty())
+		{
+			std::vector<std::shared_ptr<const detail::AccessIndex>> indices;
+			for (const auto& [name, accessIndex] : _accessIndices)
+				if (Contains(name) && accessIndex->Matches(Info(name), accessIndex->checkpointBytes))
+					indices.push_back(accessIndex);
+			detail::SaveAccessIndices(options.indexFileName, indices);
+		}
+
+		return index;
+	}
+
+	inline const detail::InflateCheckpoint* detail::AccessIndex::Find(const uint64_t uncompressedOffset) const noexcept
+	{
+		const auto iter = std::upper_bound(checkpoints.begin(), checkpoints.end(), uncompressedOffset,
+										   [](const uint64_t offset, const InflateCheckpoint& checkpoint) { return offset < checkpoint.uncompressedOffset; });
+		return iter == checkpoints.begin() ? nullptr : &*std::prev(iter);
+	}
+
+	namespace detail
+	{
+		static constexpr char accessIndexMagic[] { "NPZRAN02" };
+
+		inline void SaveAccessIndices(const std::string& fileName, const std::vector<std::shared_ptr<const AccessIndex>>& indices)
+		{
+			std::string buffer(accessIndexMagic, sizeof(accessIndexMagic) - 1);
+			appendBytes<uint64_t>(buffer, indices.size());
+			for (const auto& index : indices)
+			{
+				appendBytes<uint16_t>(buffer, static_cast<uint16_t>(index->member.name.size()));
+				buffer += index->member.name;
+				appendBytes<uint32_t>(buffer, index->member.crc);
+				appendBytes<uint64_t>(buffer, index->member.compressedBytes);
+				appendBytes<uint64_t>(buffer, index->member.uncompressedBytes);
+				appendBytes<uint64_t>(buffer, index->member.localHeaderOffset);
+				appendBytes<uint64_t>(buffer, index->checkpointBytes);
+				appendBytes<uint64_t>(buffer, index->checkpoints.size());
+				for (const auto& checkpoint : index->checkpoints)
+				{
+					appendBytes<uint64_t>(buffer, checkpoint.compressedOffset);
+					appendBytes<uint64_t>(buffer, checkpoint.uncompressedOffset);
+					appendBytes<uint8_t>(buffer, static_cast<uint8_t>(checkpoint.bits));
+					appendBytes<uint32_t>(buffer, static_cast<uint32_t>(checkpoint.window.size()));
+					buffer.append(checkpoint.window.begin(), checkpoint.window.end());
+				}
+			}
+			appendBytes<uint32_t>(buffer, Crc32(0, buffer.data(), buffer.size()));
+
+			// it's only a cache: if it can't be written (e.g. read-only directory), indices are rebuilt next time
+			const std::string tmpFileName = fileName + ".tmp";
+			FILE* fp = nullptr;
+			FOPEN(fp, tmpFileName.c_str(), "wb");
+			if (fp == nullptr)
+				return;
+			const bool written = fwrite(buffer.data(), sizeof(char), buffer.size(), fp) == buffer.size();
+			if (std::fclose(fp) != 0 || !written || !ReplaceFile(tmpFileName, fileName))
+				std::remove(tmpFileName.c_str());
+		}
+
+		inline std::vector<std::shared_ptr<const AccessIndex>> LoadAccessIndices(const std::string& fileName)
+		{
+			const RandomAccessFile file(fileName);
+			std::string buffer(file.IsValid() ? file.size() : 0, ' ');
+			if (buffer.size() < sizeof(accessIndexMagic) - 1 + sizeof(uint32_t) || !file.ReadAt(buffer.data(), buffer.size(), 0)
+				|| buffer.compare(0, sizeof(accessIndexMagic) - 1, accessIndexMagic) != 0)
+				return {};
+
+			// a torn or corrupt file would yield wrong rows
+			const auto crc = readBytes<uint32_t>(buffer.data() + buffer.size() - sizeof(uint32_t));
+			buffer.resize(buffer.size() - sizeof(uint32_t));
+			if (Crc32(0, buffer.data(), buffer.size()) != crc)
+				return {};
+
+			size_t position = sizeof(accessIndexMagic) - 1;
+			const auto skip = [&](const uint64_t nBytes)
+			{
+				if (nBytes > buffer.size() - position)
+					throw std::runtime_error("truncated access index");
+				position += static_cast<size_t>(nBytes);
+				return buffer.data() + position - nBytes;
+			};
+			const auto read = [&](auto value) { return readBytes<decltype(value)>(skip(sizeof(value))); };
+
+			std::vector<std::shared_ptr<const AccessIndex>> indices;
+			try
+			{
+				const auto nIndices = read(uint64_t {});
+				for (uint64_t i = 0; i < nIndices; ++i)
+				{
+					auto index = std::make_shared<AccessIndex>();
+					const auto nameLength = read(uint16_t {});
+					index->member.name.assign(skip(nameLength), nameLength);
+					index->member.crc = read(uint32_t {});
+					index->member.compressedBytes = read(uint64_t {});
+					index->member.uncompressedBytes = read(uint64_t {});
+					index->member.localHeaderOffset = read(uint64_t {});
+					index->checkpointBytes = read(uint64_t {});
+					const auto nCheckpoints = read(uint64_t {});
+					for (uint64_t j = 0; j < nCheckpoints; ++j)
+					{
+						InflateCheckpoint checkpoint;
+						checkpoint.compressedOffset = read(uint64_t {});
+						checkpoint.uncompressedOffset = read(uint64_t {});
+						checkpoint.bits = read(uint8_t {});
+						const auto windowBytes = read(uint32_t {});
+						const char* window = skip(windowBytes);
+						checkpoint.window.assign(window, window + windowBytes);
+						const bool ordered = index->checkpoints.empty() || index->checkpoints.back().uncompressedOffset < checkpoint.uncompressedOffset;
+						if (checkpoint.compressedOffset > index->member.compressedBytes || checkpoint.uncompressedOffset > index->member.uncompressedBytes || checkpoint.bits > 7
+							|| (checkpoint.bits > 0 && checkpoint.compressedOffset == 0) || windowBytes > (1u << 15) || !ordered)
+							throw std::runtime_error("corrupt access index");
+						index->checkpoints.push_back(std::move(checkpoint));
+					}
+					indices.push_back(std::move(index));
+				}
+			}
+			catch (const std::runtime_error&)
+			{
+				// rebuilt on demand
+				return {};
+			}
+
+			return indices;
+		}
+	}	 // namespace detail
+
+	inline std::unique_ptr<FILE, int (*)(FILE*)> NpzArchive::OpenForUpdate() const
+	{
+		FILE* fp = nullptr;
+		FOPEN(fp, _fileName.c_str(), "r+b");
+		if (fp == nullptr)
+			throw std::runtime_error("cannot open " + _fileName + " for writing");
+		return { fp, &std::fclose };
+	}
+
+	inline void NpzArchive::WriteCentralDirectory(FILE* fp, std::vector<detail::ZipEntry>&& entries, const uint64_t offset)
+	{
+		std::string globalHeader;
+		for (const auto& entry : entries)
+			detail::AppendGlobalHeader(globalHeader, entry);
+		const std::string footer = detail::GetNpzFooter(entries.size(), globalHeader.size(), offset);
+
+		if (!detail::Seek(fp, static_cast<int64_t>(offset), SEEK_SET))
+			throw std::runtime_error("cannot seek in " + _fileName);
+		detail::WriteBytes(fp, globalHeader.data(), globalHeader.size());
+		detail::WriteBytes(fp, footer.data(), footer.size());
+		if (!detail::TruncateFile(fp, offset + globalHeader.size() + footer.size()))
+			throw std::runtime_error("cannot truncate " + _fileName);
+
+		_globalHeaderOffset = offset;
+		Index(std::move(entries));
+	}
+
+	template<typename T>
+	void NpzArchive::Replace(const std::string& name, const std::vector<T>& data, const std::vector<size_t>& shape, const CompressionOptions& options)
+	{
+		assert(std::accumulate(shape.begin(), shape.end(), size_t { 1 }, std::multiplies<>()) <= data.size());
+		auto fp = OpenForUpdate();
+
+		// the new member goes where the central directory starts
+		if (!detail::Seek(fp.get(), static_cast<int64_t>(_globalHeaderOffset), SEEK_SET))
+			throw std::runtime_error("cannot seek in " + _fileName);
+		auto newEntry = detail::WriteMember(fp.get(), _globalHeaderOffset, name + ".npy", data.data(), shape, options);
+		const uint64_t globalHeaderOffset = _globalHeaderOffset + detail::GetLocalHeaderSize(newEntry) + newEntry.compressedBytes;
+
+		// the new record takes the place of the one that was loaded so far, duplicates are dropped
+		const auto& members = Members();
+		std::vector<detail::ZipEntry> entries;
+		entries.reserve(members.size() + 1);
+		for (size_t i = 0; i < members.size(); ++i)
+		{
+			if (members[i].name != name)
+				entries.push_back(Entries()[i]);
+			else if (&Info(name) == &members[i])
+				entries.push_back(newEntry);
+		}
+		if (!Contains(name))
+			entries.push_back(std::move(newEntry));
+
+		WriteCentralDirectory(fp.get(), std::move(entries), globalHeaderOffset);
+		if (std::fclose(fp.release()) != 0)
+			throw std::runtime_error("cannot write to " + _fileName);
+	}
+
+	inline bool NpzArchive::Remove(const std::string& name)
+	{
+		if (!Contains(name))
+			return false;
+
+		std::vector<detail::ZipEntry> entries;
+		const auto& members = Members();
+		for (size_t i = 0; i < members.size(); ++i)
+			if (members[i].name != name)
+				entries.push_back(Entries()[i]);
+
+		auto fp = OpenForUpdate();
+		WriteCentralDirectory(fp.get(), std::move(entries), _globalHeaderOffset);
+		if (std::fclose(fp.release()) != 0)
+			throw std::runtime_error("cannot write to " + _fileName);
+
+		return true;
+	}
+
+	inline uint64_t NpzArchive::GetUnreferencedBytes() const
+	{
+		uint64_t referencedBytes = 0;
+		for (const auto& info : Members())
+			referencedBytes += GetDataOffset(info) - info.localHeaderOffset + info.compressedBytes;
+
+		// data descriptors, if any, are counted as unreferenced
+		return _globalHeaderOffset > referencedBytes ? _globalHeaderOffset - referencedBytes : 0;
+	}
+
+	inline void NpzArchive::Compact()
+	{
+		const std::string tmpFileName = _fileName + ".tmp";
+		FILE* fp = nullptr;
+		FOPEN(fp, tmpFileName.c_str(), "wb");
+		if (fp == nullptr)
+			throw std::runtime_error("cannot open " + tmpFileName);
+		std::unique_ptr<FILE, int (*)(FILE*)> tmpFile { fp, &std::fclose };
+
+		const auto fail = [&](const std::string& message)
+		{
+			tmpFile.reset();
+			std::remove(tmpFileName.c_str());
+			throw std::runtime_error(message);
+		};
+
+		// members are written in archive order, with a new local header, as their offsets change
+		std::vector<detail::ZipEntry> entries = Entries();
+		const auto& members = Members();
+		uint64_t offset = 0;
+		for (size_t i = 0; i < members.size(); ++i)
+		{
+			auto& entry = entries[i];
+			const uint64_t dataOffset = GetDataOffset(members[i]);
+
+			// sizes are known, so data descriptors aren't needed anymore
+			entry.flags = static_cast<uint16_t>(entry.flags & ~uint16_t { 0x08 });
+			entry.zip64 = entry.zip64 || entry.compressedBytes >= detail::zip64Marker32 || entry.uncompressedBytes >= detail::zip64Marker32;
+			entry.localHeaderOffset = offset;
+			if (members[i].IsStored())
+			{
+				// aligned members stay aligned at their new offset
+				const auto alignment = GetAlignment(members[i], dataOffset);
+				std::array<unsigned char, detail::npyPreambleSize> preamble {};
+				if (alignment > 0 && !_file.ReadAt(preamble.data(), preamble.size(), dataOffset))
+					fail("cannot read member '" + members[i].name + "' of " + _fileName);
+				detail::SetAlignmentPadding(entry, alignment > 0 ? detail::GetNpyHeaderSize(preamble.data()) : 0, alignment);
+			}
+			const std::string localHeader = detail::GetLocalHeader(entry);
+			if (fwrite(localHeader.data(), sizeof(char), localHeader.size(), fp) != localHeader.size())
+				fail("cannot write to " + tmpFileName);
+			offset += localHeader.size();
+
+			if (!detail::CopyRange(_file, dataOffset, fp, offset, entry.compressedBytes))
+				fail("cannot copy member '" + members[i].name + "' to " + tmpFileName);
+			offset += entry.compressedBytes;
+		}
+
+		std::string globalHeader;
+		for (const auto& entry : entries)
+			detail::AppendGlobalHeader(globalHeader, entry);
+		const std::string footer = detail::GetNpzFooter(entries.size(), globalHeader.size(), offset);
+		if (fwrite(globalHeader.data(), sizeof(char), globalHeader.size(), fp) != globalHeader.size() || fwrite(footer.data(), sizeof(char), footer.size(), fp) != footer.size()
+			|| std::fclose(tmpFile.release()) != 0)
+			fail("cannot write to " + tmpFileName);
+
+		_file.Close();
+		if (!detail::ReplaceFile(tmpFileName, _fileName))
+			throw std::runtime_error("cannot replace " + _fileName);
+		_file = detail::RandomAccessFile(_fileName);
+		if (!_file.IsValid())
+			throw std::runtime_error("cannot open " + _fileName);
+
+		_globalHeaderOffset = offset;
+		Index(std::move(entries));
+	}
+
+	template<typename T>
+	CompressedMapFull<T> LoadCompressedFull(const std::string& zipFileName, const NpzLoadOptions& options)
+	{
+		return NpzArchive(zipFileName).LoadAll<T>(options);
+	}
+
+	template<typename T>
+	MultiDimensionalArray<T> LoadCompressedFull(const std::string& zipFileName, const std::string& vectorName, const NpzLoadOptions& options)
+	{
+		NpzArchive archive(zipFileName);
+		if (!archive.Contains(vectorName))
+			return MultiDimensionalArray<T>();
+
+		return archive.Load<T>(vectorName, options);
+	}
+}	 // namespace npypp
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Npy++.h>
+
+#include <cstdio>
+#include <exception>
+#include <memory>
+
+namespace npypp
+{
+	/**
+	 * Writes any number of members, of any type, to an *.npz file kept open in between.
+	 * Members are written one after the other, while their central directory records are accumulated in memory: the central directory
+	 * and the footer are written once, by Close() (or the destructor), rather than rewritten after every member as SaveCompressed does
+	 */
+	class NpzWriter
+	{
+	public:
+		/// "w" truncates the file, "a" adds members to an existing archive (creating it if needed)
+		explicit NpzWriter(const std::string& fileName, const std::string& mode = "w", const CompressionOptions& options = {});
+		NpzWriter(const std::string& fileName, const FileOpenMode mode, const CompressionOptions& options = {}) : NpzWriter(fileName, ToString(mode), options) {}
+
+		NpzWriter(const NpzWriter&) = delete;
+		NpzWriter(NpzWriter&&) noexcept = default;
+		NpzWriter& operator=(const NpzWriter&) = delete;
+		/// an open archive would be left without its central directory
+		NpzWriter& operator=(NpzWriter&&) = delete;
+
+		/// errors can't be reported from here: call Close() explicitly to get them
+		~NpzWriter() noexcept;
+
+		/// write a member with the archive's compression options
+		template<typename T>
+		void Write(const std::string& name, const std::vector<T>& data, const std::vector<size_t>& shape)
+		{
+			Write(name, data, shape, _options);
+		}
+
+		/// write a member with its own compression options
+		template<typename T>
+		void Write(const std::string& name, const std::vector<T>& data, const std::vector<size_t>& shape, const CompressionOptions& options);
+
+		template<typename T>
+		void Write(const std::string& name, const MultiDimensionalArray<T>& array)
+		{
+			Write(name, array.data, array.shape, _options);
+		}
+
+		/**
+		 * Start a member whose data is written in chunks, e.g. because it doesn't fit in memory, with the archive's compression options.
+		 * The local header is written with placeholder CRC and sizes, and patched by EndMember
+		 */
+		template<typename T>
+		void BeginMember(const std::string& name, const std::vector<size_t>& shape)
+		{
+			BeginMember<T>(name, shape, _options);
+		}
+
+		template<typename T>
+		void BeginMember(const std::string& name, const std::vector<size_t>& shape, const CompressionOptions& options);
+
+		/// append nElements to the member started by BeginMember, in row-major order
+		template<typename T>
+		void Write(const T* data, size_t nElements);
+
+		template<typename T>
+		void Write(const std::vector<T>& chunk)
+		{
+			Write(chunk.data(), chunk.size());
+		}
+
+		/// throws std::runtime_error if fewer or more elements than the shape given to BeginMember were written
+		void EndMember();
+
+		/**
+		 * write the central directory and the footer, and close the file. Throws std::runtime_error on I/O errors, or if a member
+		 * still being written doesn't match its shape: it's dropped, while the archive is closed with the other members
+		 */
+		void Close();
+
+		[[nodiscard]] bool IsOpen() const noexcept { return _fp != nullptr; }
+
+		/// number of members in the archive, including the ones already there when appending
+		[[nodiscard]] uint64_t size() const noexcept { return _nRecords; }
+
+	private:
+		std::string _fileName;
+		CompressionOptions _options {};
+		std::unique_ptr<FILE, int (*)(FILE*)> _fp { nullptr, &std::fclose };
+
+		/// member being written by chunks
+		std::unique_ptr<detail::MemberWriter> _memberWriter {};
+		detail::ZipEntry _memberEntry {};
+		uint64_t _memberBytes = 0;	  ///< expected uncompressed size, header included
+		size_t _memberWordSize = 0;
+
+		std::string _globalHeader {};
+		uint64_t _nRecords = 0;
+		/// where the next local header goes, i.e. where the central directory is going to start
+		uint64_t _offset = 0;
+	};
+}	 // namespace npypp
+
+#include <NpzWriter.tpp>
@@ -0,0 +1,143 @@
+#pragma once
+
+namespace npypp
+{
+	inline NpzWriter::NpzWriter(const std::string& fileName, const std::string& mode, const CompressionOptions& options) : _fileName(fileName), _options(options)
+	{
+		FILE* fp = nullptr;
+		if (mode == "a")
+			FOPEN(fp, fileName.c_str(), "r+b");
+
+		if (fp != nullptr)
+		{
+			_fp.reset(fp);
+
+			// keep the existing central directory: new members are written over it, and it's written back, extended, on Close
+			uint64_t globalHeaderSize = 0;
+			detail::ParseNpzFooter(fp, _nRecords, globalHeaderSize, _offset);
+			_globalHeader.resize(globalHeaderSize);
+			if (!detail::Seek(fp, static_cast<int64_t>(_offset), SEEK_SET) || fread(_globalHeader.data(), sizeof(char), _globalHeader.size(), fp) != _globalHeader.size())
+				throw std::runtime_error("truncated central directory in " + fileName);
+			if (!detail::Seek(fp, static_cast<int64_t>(_offset), SEEK_SET))
+				throw std::runtime_error("cannot seek in " + fileName);
+		}
+		else
+		{
+			FOPEN(fp, fileName.c_str(), "wb");
+			if (fp == nullptr)
+				throw std::runtime_error("cannot open " + fileName);
+			_fp.reset(fp);
+		}
+	}
+
+	inline NpzWriter::~NpzWriter() noexcept
+	{
+		try
+		{
+			Close();
+		}
+		catch (...)	   // NOLINT(bugprone-empty-catch)
+		{
+		}
+	}
+
+	template<typename T>
+	void NpzWriter::Write(const std::string& name, const std::vector<T>& data, const std::vector<size_t>& shape, const CompressionOptions& options)
+	{
+		assert(IsOpen() && !_memberWriter);
+
+		assert(std::accumulate(shape.begin(), shape.end(), size_t { 1 }, std::multiplies<>()) <= data.size());
+
+		// the .npz file stores multiple npy files
+		const auto entry = detail::WriteMember(_fp.get(), _offset, name + ".npy", data.data(), shape, options);
+		detail::AppendGlobalHeader(_globalHeader, entry);
+		++_nRecords;
+		_offset = entry.localHeaderOffset + detail::GetLocalHeaderSize(entry) + entry.compressedBytes;
+	}
+
+	template<typename T>
+	void NpzWriter::BeginMember(const std::string& name, const std::vector<size_t>& shape, const CompressionOptions& options)
+	{
+		assert(IsOpen());
+		if (_memberWriter)
+			throw std::runtime_error("member '" + _memberEntry.name + "' of " + _fileName + " is still being written");
+
+		_memberEntry = detail::BeginMember<T>(_fp.get(), _offset, name + ".npy", shape, options);
+		_memberWriter = std::make_unique<detail::MemberWriter>(_fp.get(), options);
+
+		const std::string npyHeader = detail::GetNpyHeader<T>(shape);
+		_memberWriter->Write(npyHeader.data(), npyHeader.size());
+		_memberBytes = npyHeader.size() + std::accumulate(shape.begin(), shape.end(), size_t { 1 }, std::multiplies<>()) * sizeof(T);
+		_memberWordSize = sizeof(T);
+	}
+
+	template<typename T>
+	void NpzWriter::Write(const T* data, const size_t nElements)
+	{
+		assert(_memberWriter && _memberWordSize == sizeof(T));
+		_memberWriter->Write(data, nElements * sizeof(T));
+	}
+
+	inline void NpzWriter::EndMember()
+	{
+		assert(_memberWriter);
+		auto memberWriter = std::move(_memberWriter);
+		if (memberWriter->GetUncompressedBytes() != _memberBytes)
+		{
+			// the member is dropped: what was written of it gets overwritten by the next one, or truncated by Close()
+			memberWriter.reset();
+			if (!detail::Seek(_fp.get(), static_cast<int64_t>(_offset), SEEK_SET))
+				throw std::runtime_error("cannot seek in " + _fileName);
+			throw std::runtime_error("member '" + _memberEntry.name + "' of " + _fileName + " doesn't match its shape");
+		}
+
+		detail::EndMember(_fp.get(), _memberEntry, *memberWriter);
+		detail::AppendGlobalHeader(_globalHeader, _memberEntry);
+		++_nRecords;
+		_offset = _memberEntry.localHeaderOffset + detail::GetLocalHeaderSize(_memberEntry) + _memberEntry.compressedBytes;
+	}
+
+	inline void NpzWriter::Close()
+	{
+		if (!IsOpen())
+			return;
+
+		// a member that can't be ended is dropped, but the archive is still closed with the finished ones, and the error rethrown
+		std::exception_ptr memberError;
+		if (_memberWriter)
+		{
+			try
+			{
+				EndMember();
+			}
+			catch (...)
+			{
+				memberError = std::current_exception();
+			}
+		}
+
+		// what was written of a dropped member is overwritten, and truncated
+		if (!detail::Seek(_fp.get(), static_cast<int64_t>(_offset), SEEK_SET))
+			throw std::runtime_error("cannot seek in " + _fileName);
+		const std::string footer = detail::GetNpzFooter(_nRecords, _globalHeader.size(), _offset, _options.forceZip64);
+		detail::WriteBytes(_fp.get(), _globalHeader.data(), _globalHeader.size());
+		detail::WriteBytes(_fp.get(), footer.data(), footer.size());
+		if (!detail::TruncateFile(_fp.get(), _offset + _globalHeader.size() + footer.size()))
+			throw std::runtime_error("cannot truncate " + _fileName);
+
+		if (std::fclose(_fp.release()) != 0)
+			throw std::runtime_error("cannot write to " + _fileName);
+
+		if (memberError)
+			std::rethrow_exception(memberError);
+	}
+
+	template<typename T>
+	void SaveCompressed(const std::string& zipFileName, std::string vectorName, const std::vector<T>& data, const std::vector<size_t>& shape, const std::string& mode,
+						const CompressionOptions& options)
+	{
+		NpzWriter writer(zipFileName, mode, options);
+		writer.Write(vectorName, data, shape);
+		writer.Close();
+	}
+}	 // namespace npypp
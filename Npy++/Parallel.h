@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace npypp
+{
+	namespace detail
+	{
+		/// 0 means as many threads as the hardware supports
+		static inline size_t GetNumberOfThreads(const size_t nThreads)
+		{
+			if (nThreads != 0)
+				return nThreads;
+			return std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		/**
+		 * Run task(i) for every i in [0, nTasks) on at most nThreads threads, the calling one included.
+		 * Tasks are handed out dynamically, so that uneven tasks don't stall the others. The first exception thrown by a task is rethrown here.
+		 * Threads that can't be started (e.g. over the thread limit) are done without: their tasks are run by the others
+		 */
+		template<typename F>
+		void ParallelFor(const size_t nTasks, size_t nThreads, F&& task)
+		{
+			nThreads = std::min(GetNumberOfThreads(nThreads), nTasks);
+			if (nThreads <= 1)
+			{
+				for (size_t i = 0; i < nTasks; ++i)
+					task(i);
+				return;
+			}
+
+			std::atomic<size_t> nextTask { 0 };
+			std::exception_ptr exception = nullptr;
+			std::mutex exceptionMutex;
+
+			auto worker = [&]()
+			{
+				for (size_t i = nextTask++; i < nTasks; i = nextTask++)
+				{
+					try
+					{
+						task(i);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(exceptionMutex);
+						if (!exception)
+							exception = std::current_exception();
+						nextTask = nTasks;
+					}
+				}
+			};
+
+			std::vector<std::thread> threads;
+			threads.reserve(nThreads - 1);
+			for (size_t i = 1; i < nThreads; ++i)
+			{
+				// e.g. out of threads: the started ones must still be joined, and the calling one runs what is left
+				try
+				{
+					threads.emplace_back(worker);
+				}
+				catch (const std::system_error&)
+				{
+					break;
+				}
+			}
+			worker();
+			for (auto& thread : threads)
+				thread.join();
+
+			if (exception)
+				std::rethrow_exception(exception);
+		}
+	}	 // namespace detail
+}	 // namespace npypp
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+	#include <io.h>
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace npypp
+{
+	namespace detail
+	{
+		/**
+		 * Read-only file accessed with positional reads (pread), which don't share a file position:
+		 * concurrent reads from multiple threads don't need any synchronization
+		 */
+		class RandomAccessFile
+		{
+		public:
+			explicit RandomAccessFile(const std::string& fileName) noexcept
+			{
+#ifdef _MSC_VER
+				_fileHandle = ::CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+				LARGE_INTEGER fileSize;
+				if (IsValid() && ::GetFileSizeEx(_fileHandle, &fileSize))
+					_fileSize = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+				_fileHandle = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+				struct stat statInfo {};
+				if (IsValid() && ::fstat(_fileHandle, &statInfo) == 0)
+					_fileSize = static_cast<uint64_t>(statInfo.st_size);
+#endif
+			}
+
+			RandomAccessFile(const RandomAccessFile&) = delete;
+			RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+			RandomAccessFile(RandomAccessFile&& rhs) noexcept : _fileHandle(rhs._fileHandle), _fileSize(rhs._fileSize) { rhs._fileHandle = invalidHandle; }
+			RandomAccessFile& operator=(RandomAccessFile&& rhs) noexcept
+			{
+				std::swap(_fileHandle, rhs._fileHandle);
+				std::swap(_fileSize, rhs._fileSize);
+				return *this;
+			}
+
+			~RandomAccessFile() noexcept { Close(); }
+
+			void Close() noexcept
+			{
+				if (!IsValid())
+					return;
+#ifdef _MSC_VER
+				::CloseHandle(_fileHandle);
+#else
+				::close(_fileHandle);
+#endif
+				_fileHandle = invalidHandle;
+				_fileSize = 0;
+			}
+
+			[[nodiscard]] bool IsValid() const noexcept { return _fileHandle != invalidHandle; }
+
+			[[nodiscard]] uint64_t size() const noexcept { return _fileSize; }
+
+			/// read nBytes at offset, retrying on partial reads; false on errors or if the file is shorter
+			[[nodiscard]] bool ReadAt(void* buffer, uint64_t nBytes, uint64_t offset) const noexcept
+			{
+				auto* out = static_cast<char*>(buffer);
+				while (nBytes > 0)
+				{
+					// at most 1GB per call, as on Linux reads are capped to ~2GB anyway
+					constexpr uint64_t maxChunkBytes { 1u << 30 };
+					const auto chunkBytes = nBytes < maxChunkBytes ? nBytes : maxChunkBytes;
+#ifdef _MSC_VER
+					OVERLAPPED overlapped {};
+					overlapped.Offset = static_cast<DWORD>(offset);
+					overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+					DWORD bytesRead = 0;
+					if (!::ReadFile(_fileHandle, out, static_cast<DWORD>(chunkBytes), &bytesRead, &overlapped) || bytesRead == 0)
+						return false;
+#else
+					const ssize_t bytesRead = ::pread(_fileHandle, out, static_cast<size_t>(chunkBytes), static_cast<off_t>(offset));
+					if (bytesRead <= 0)
+					{
+						if (bytesRead < 0 && errno == EINTR)
+							continue;
+						return false;
+					}
+#endif
+					out += bytesRead;
+					offset += static_cast<uint64_t>(bytesRead);
+					nBytes -= static_cast<uint64_t>(bytesRead);
+				}
+				return true;
+			}
+
+#ifdef _MSC_VER
+			using FileHandle = HANDLE;
+			static inline const FileHandle invalidHandle = INVALID_HANDLE_VALUE;
+#else
+			using FileHandle = int;
+			static constexpr FileHandle invalidHandle = -1;
+#endif
+
+			[[nodiscard]] FileHandle GetHandle() const noexcept { return _fileHandle; }
+
+		private:
+			FileHandle _fileHandle = invalidHandle;
+			uint64_t _fileSize = 0;
+		};
+
+		/// fseek with 64 bits offsets, also where long is 32 bits wide (e.g. on Windows)
+		[[nodiscard]] static inline bool Seek(FILE* fp, const int64_t offset, const int origin) noexcept
+		{
+#ifdef _MSC_VER
+			return _fseeki64(fp, offset, origin) == 0;
+#else
+			return fseeko(fp, static_cast<off_t>(offset), origin) == 0;
+#endif
+		}
+
+		/// ftell with 64 bits offsets, -1 on errors
+		[[nodiscard]] static inline int64_t Tell(FILE* fp) noexcept
+		{
+#ifdef _MSC_VER
+			return _ftelli64(fp);
+#else
+			return static_cast<int64_t>(ftello(fp));
+#endif
+		}
+
+		/// copy nBytes from src at srcOffset to dst at dstOffset, through a bounce buffer
+		static inline bool CopyRangeBuffered(const RandomAccessFile& src, uint64_t srcOffset, FILE* dst, const uint64_t dstOffset, uint64_t nBytes)
+		{
+			constexpr uint64_t bufferBytes { 1u << 20 };
+			std::vector<char> buffer(static_cast<size_t>(std::min(nBytes, bufferBytes)));
+			if (!Seek(dst, static_cast<int64_t>(dstOffset), SEEK_SET))
+				return false;
+
+			while (nBytes > 0)
+			{
+				const auto chunkBytes = static_cast<size_t>(std::min<uint64_t>(nBytes, buffer.size()));
+				if (!src.ReadAt(buffer.data(), chunkBytes, srcOffset) || fwrite(buffer.data(), sizeof(char), chunkBytes, dst) != chunkBytes)
+					return false;
+				srcOffset += chunkBytes;
+				nBytes -= chunkBytes;
+			}
+			return true;
+		}
+
+		/**
+		 * Copy nBytes from src at srcOffset to dst at dstOffset. On Linux, copy_file_range copies in the kernel (or shares extents on
+		 * filesystems supporting reflinks), so that the data never goes through user space; otherwise, or if it's not supported
+		 * (e.g. across filesystems), falls back to buffered reads and writes. dst is left positioned at the end of the copy
+		 */
+		static inline bool CopyRange(const RandomAccessFile& src, uint64_t srcOffset, FILE* dst, uint64_t dstOffset, uint64_t nBytes)
+		{
+#ifdef __linux__
+			// writes through dst's buffer must land before the ones bypassing it
+			if (fflush(dst) != 0)
+				return false;
+
+			auto inOffset = static_cast<loff_t>(srcOffset);
+			auto outOffset = static_cast<loff_t>(dstOffset);
+			while (nBytes > 0)
+			{
+				const ssize_t bytesCopied = ::copy_file_range(src.GetHandle(), &inOffset, fileno(dst), &outOffset, static_cast<size_t>(std::min<uint64_t>(nBytes, 1u << 30)), 0);
+				if (bytesCopied <= 0)
+				{
+					if (bytesCopied < 0 && errno == EINTR)
+						continue;
+					break;
+				}
+				nBytes -= static_cast<uint64_t>(bytesCopied);
+			}
+			srcOffset = static_cast<uint64_t>(inOffset);
+			dstOffset = static_cast<uint64_t>(outOffset);
+			if (nBytes == 0)
+				return Seek(dst, static_cast<int64_t>(dstOffset), SEEK_SET);
+#endif
+			return CopyRangeBuffered(src, srcOffset, dst, dstOffset, nBytes);
+		}
+
+		/**
+		 * fread nBytes into buffer. If releaseBehindBytes isn't 0, reads in chunks and drops from the page cache (POSIX_FADV_DONTNEED)
+		 * the pages more than releaseBehindBytes behind, so that streaming a large file once doesn't evict everything else
+		 */
+		static inline bool ReadReleasingBehind(FILE* fp, void* buffer, uint64_t nBytes, const uint64_t releaseBehindBytes)
+		{
+#ifdef __linux__
+			if (releaseBehindBytes != 0)
+			{
+				const auto pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+				const int64_t start = Tell(fp);
+				if (start < 0)
+					return false;
+				uint64_t position = static_cast<uint64_t>(start);
+				uint64_t releasedOffset = (position + pageSize - 1) / pageSize * pageSize;
+
+				constexpr uint64_t chunkBytes { 1u << 20 };
+				auto* out = static_cast<char*>(buffer);
+				while (nBytes > 0)
+				{
+					const auto bytesToRead = static_cast<size_t>(std::min(nBytes, chunkBytes));
+					if (fread(out, sizeof(char), bytesToRead, fp) != bytesToRead)
+						return false;
+					out += bytesToRead;
+					position += bytesToRead;
+					nBytes -= bytesToRead;
+
+					if (position >= releasedOffset + releaseBehindBytes + chunkBytes)
+					{
+						const uint64_t releaseEnd = (position - releaseBehindBytes) / pageSize * pageSize;
+						::posix_fadvise(fileno(fp), static_cast<off_t>(releasedOffset), static_cast<off_t>(releaseEnd - releasedOffset), POSIX_FADV_DONTNEED);
+						releasedOffset = releaseEnd;
+					}
+				}
+				return true;
+			}
+#else
+			(void)releaseBehindBytes;
+#endif
+			return fread(buffer, sizeof(char), static_cast<size_t>(nBytes), fp) == nBytes;
+		}
+
+		static inline bool TruncateFile(FILE* fp, const uint64_t size)
+		{
+			if (fflush(fp) != 0)
+				return false;
+#ifdef _MSC_VER
+			return _chsize_s(_fileno(fp), static_cast<long long>(size)) == 0;
+#else
+			return ::ftruncate(fileno(fp), static_cast<off_t>(size)) == 0;
+#endif
+		}
+
+		/// atomically replace target with source, which must be closed on Windows
+		static inline bool ReplaceFile(const std::string& source, const std::string& target)
+		{
+#ifdef _MSC_VER
+			return ::MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+		}
+	}	 // namespace detail
+}	 // namespace npypp
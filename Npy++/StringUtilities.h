@@ -29,4 +29,39 @@ namespace utils
 
 		return out;
 	}
+
+	/// shell-style wildcard matching: '*' matches any sequence of characters (including none), '?' any single character
+	static inline bool GlobMatch(const std::string& pattern, const std::string& str) noexcept
+	{
+		size_t p = 0;
+		size_t s = 0;
+		size_t starPattern = std::string::npos;	   // position after the last '*' seen, to backtrack to
+		size_t starString = 0;
+
+		while (s < str.size())
+		{
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == str[s]))
+			{
+				++p;
+				++s;
+			}
+			else if (p < pattern.size() && pattern[p] == '*')
+			{
+				starPattern = ++p;
+				starString = s;
+			}
+			else if (starPattern != std::string::npos)
+			{
+				// let the last '*' swallow one more character
+				p = starPattern;
+				s = ++starString;
+			}
+			else
+				return false;
+		}
+
+		while (p < pattern.size() && pattern[p] == '*')
+			++p;
+		return p == pattern.size();
+	}
 }	 // namespace utils
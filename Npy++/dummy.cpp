@@ -1,3 +1,7 @@
 
 #include "MemoryMappedFile.h"
 #include "Npy++.h"
+#include "MappedViews.h"
+#include "NpzArchive.h"
+#include "MappedNpzArchive.h"
+#include "NpzWriter.h"
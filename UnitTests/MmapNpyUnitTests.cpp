@@ -1,9 +1,28 @@
 #include "pch.h"
+#include <HugePageAllocator.h>
+#include <MappedViews.h>
+#include <MappingRegistry.h>
 #include <Npy++.h>
+#include <WindowedMappedFile.h>
 
+#include <algorithm>
+#include <chrono>
 #include <complex>
 #include <cstdlib>
+#include <fstream>
 #include <map>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/resource.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
 
 constexpr size_t Nx { 128 };
 constexpr size_t Ny { 64 };
@@ -167,3 +186,661 @@ TEST_F(MmapNpyTests, AppendFull)
 		ASSERT_TRUE(data[i] == loadedData.data[i + TotalSize]);
 	}
 }
+
+namespace
+{
+	/// write data as a big-endian npy file, regardless of the system endianness
+	template<typename T>
+	void SaveBigEndian(const std::string& fileName, std::vector<T> data, const std::vector<size_t>& arrayShape)
+	{
+		std::string header = npypp::detail::GetNpyHeader<T>(arrayShape);
+		if (npypp::detail::SysEndianness() == '<')
+		{
+			header[header.find("'descr': '<") + 10] = '>';
+			npypp::detail::SwapEndianness(data);
+		}
+
+		FILE* fp = std::fopen(fileName.c_str(), "wb");
+		ASSERT_NE(fp, nullptr);
+		std::fwrite(header.data(), sizeof(char), header.size(), fp);
+		std::fwrite(data.data(), sizeof(T), data.size(), fp);
+		std::fclose(fp);
+	}
+}	 // namespace
+
+TEST_F(MmapNpyTests, ByteSwappedViewRandomAccess)
+{
+	SaveBigEndian("arr1.npy", data, shape);
+
+	mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf("arr1.npy");
+	ASSERT_TRUE(mmf.IsValid());
+	const npypp::ByteSwappedView<std::complex<double>> view(mmf);
+	ASSERT_EQ(view.IsSwapped(), npypp::detail::SysEndianness() == '<');
+	ASSERT_EQ(view.size(), TotalSize);
+	ASSERT_EQ(view.GetShape(), shape);
+
+	for (size_t i = 0; i < TotalSize; i += 97)
+		ASSERT_TRUE(data[i] == view[i]);
+
+	size_t i = 0;
+	for (const auto x : view)
+		ASSERT_TRUE(data[i++] == x);
+	ASSERT_EQ(i, TotalSize);
+	ASSERT_TRUE(*(view.end() - 1) == data.back());
+}
+
+TEST_F(MmapNpyTests, ByteSwappedViewGather)
+{
+	std::vector<double> realData(TotalSize);
+	for (size_t i = 0; i < TotalSize; i++)
+		realData[i] = data[i].real();
+	SaveBigEndian("arr1.npy", realData, shape);
+
+	mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf("arr1.npy");
+	const npypp::ByteSwappedView<double> view(mmf);
+
+	std::vector<size_t> indices;
+	for (size_t i = 0; i < 1000; i++)
+		indices.push_back(static_cast<size_t>(rand()) % TotalSize);
+
+	const auto gathered = view.Gather(indices);
+	ASSERT_EQ(gathered.size(), indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		ASSERT_EQ(gathered[i], realData[indices[i]]);
+}
+
+TEST_F(MmapNpyTests, ByteSwappedViewNativeEndianness)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+
+	mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf("arr1.npy");
+	const npypp::ByteSwappedView<std::complex<double>> view(mmf);
+	ASSERT_FALSE(view.IsSwapped());
+
+	for (size_t i = 0; i < TotalSize; i++)
+		ASSERT_TRUE(data[i] == view[i]);
+}
+
+TEST_F(MmapNpyTests, MovedMappingAndSharedRegion)
+{
+	SaveBigEndian("arr1.npy", data, shape);
+
+	using MappedFile = mm::MemoryMappedFile<mm::CacheHint::RandomAccess>;
+	const auto open = [](const std::string& fileName) { return MappedFile(fileName); };
+	MappedFile mmf = open("arr1.npy");
+	ASSERT_TRUE(mmf.IsValid());
+
+	// offset-based reads don't depend on the current position
+	const auto headerBytes = npypp::detail::GetNpyHeader<std::complex<double>>(shape).size();
+	mmf.Advance(headerBytes);
+	std::complex<double> x;
+	mmf.ReadAt(&x, headerBytes + 5 * sizeof(x), 1);
+	if (npypp::detail::SysEndianness() == '<')
+		npypp::detail::SwapEndianness(&x, 1);
+	ASSERT_TRUE(x == data[5]);
+	ASSERT_EQ(mmf.GetDataAt(0), mmf.GetData() - headerBytes);
+
+	std::unique_ptr<npypp::ByteSwappedView<std::complex<double>>> view;
+	std::shared_ptr<const mm::MappedRegion> region;
+	{
+		mmf.Rewind();
+		MappedFile moved(std::move(mmf));
+		ASSERT_FALSE(mmf.IsValid());	// NOLINT(bugprone-use-after-move)
+		ASSERT_TRUE(moved.IsValid());
+		ASSERT_EQ(moved.GetMappedBytes(), moved.size());
+		ASSERT_EQ(moved.GetMappedOffset(), 0);
+
+		view = std::make_unique<npypp::ByteSwappedView<std::complex<double>>>(moved);
+		region = moved.GetRegion();
+	}
+
+	// the mapping was closed, but the region is kept alive by its handles
+	ASSERT_EQ(region.use_count(), 2);
+	for (size_t i = 0; i < TotalSize; i += 97)
+		ASSERT_TRUE(data[i] == (*view)[i]);
+}
+
+TEST_F(MmapNpyTests, WindowedMappedFile)
+{
+	// an odd header, so that elements straddle the windows
+	FILE* fp = std::fopen("arr1.bin", "wb");
+	ASSERT_NE(fp, nullptr);
+	std::fwrite("abc", sizeof(char), 3, fp);
+	std::fwrite(data.data(), sizeof(std::complex<double>), data.size(), fp);
+	std::fclose(fp);
+
+	for (const bool prefetch : { false, true })
+	{
+		mm::WindowedMappedFile<> mmf("arr1.bin", 10000, prefetch);
+		ASSERT_TRUE(mmf.IsValid());
+		ASSERT_EQ(mmf.GetWindowBytes() % mm::PageSize(), 0);
+		ASSERT_GE(mmf.GetWindowBytes(), 10000);
+		ASSERT_EQ(mmf.size(), 3 + TotalSize * sizeof(std::complex<double>));
+
+		mmf.Skip(3);
+		for (size_t i = 0; i < TotalSize; i++)
+		{
+			const auto* x = mmf.Next(sizeof(std::complex<double>));
+			ASSERT_NE(x, nullptr);
+			ASSERT_EQ(std::memcmp(x, &data[i], sizeof(std::complex<double>)), 0);
+			ASSERT_LE(mmf.GetWindowOffset(), mmf.GetPosition());
+		}
+		ASSERT_TRUE(mmf.IsEof());
+		ASSERT_EQ(mmf.Next(1), nullptr);
+
+		// bulk reads spanning several windows, after seeking back
+		mmf.Seek(3 + 100 * sizeof(std::complex<double>));
+		std::vector<std::complex<double>> chunk(5000);
+		size_t i = 100;
+		while (size_t nRead = mmf.Read(chunk))
+		{
+			for (size_t j = 0; j < nRead; j++)
+				ASSERT_TRUE(chunk[j] == data[i + j]);
+			i += nRead;
+		}
+		ASSERT_EQ(i, TotalSize);
+	}
+
+	// at the end of a file ending on a window boundary there's no window to map
+	fp = std::fopen("arr1.bin", "wb");
+	ASSERT_NE(fp, nullptr);
+	const std::vector<unsigned char> pages(2 * mm::PageSize(), 'x');
+	std::fwrite(pages.data(), sizeof(unsigned char), pages.size(), fp);
+	std::fclose(fp);
+	for (const bool prefetch : { false, true })
+	{
+		mm::WindowedMappedFile<> mmf("arr1.bin", mm::PageSize(), prefetch);
+		ASSERT_TRUE(mmf.IsValid());
+		mmf.Seek(pages.size());
+		ASSERT_TRUE(mmf.IsEof());
+		ASSERT_EQ(mmf.Next(0), nullptr);
+		ASSERT_EQ(mmf.GetWindowOffset(), 0);
+
+		std::vector<unsigned char> chunk(16);
+		ASSERT_EQ(mmf.Read(chunk), 0);
+
+		// still usable after seeking back
+		mmf.Seek(pages.size() - 8);
+		ASSERT_EQ(mmf.Read(chunk), 8);
+		ASSERT_EQ(chunk[7], 'x');
+		mmf.Seek(mm::PageSize() - 4);
+		const auto* x = mmf.Next(8);
+		ASSERT_NE(x, nullptr);
+		ASSERT_EQ(x[7], 'x');
+	}
+}
+
+TEST_F(MmapNpyTests, PrefaultedMapping)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+	const auto headerBytes = npypp::detail::GetNpyHeader<std::complex<double>>(shape).size();
+
+	const auto minorFaults = []()
+	{
+#ifdef __linux__
+		rusage usage {};
+		getrusage(RUSAGE_THREAD, &usage);
+		return static_cast<size_t>(usage.ru_minflt);
+#else
+		return size_t { 0 };
+#endif
+	};
+
+	mm::MapOptions options;
+	options.populate = true;
+	options.willNeed = true;
+	options.prefaultThreads = 3;
+	mm::MapOptions prefaulted;
+	prefaulted.prefaultThreads = 3;
+	for (const auto& mapOptions : { mm::MapOptions {}, options, prefaulted })
+	{
+		mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf("arr1.npy", 0, mapOptions);
+		ASSERT_TRUE(mmf.IsValid());
+
+		// the first pass doesn't fault anymore, once the mapping is populated
+		const auto faultsBefore = minorFaults();
+		std::complex<double> x;
+		for (size_t i = 0; i < TotalSize; i += mm::PageSize() / sizeof(x))
+		{
+			mmf.ReadAt(&x, headerBytes + i * sizeof(x), 1);
+			ASSERT_TRUE(x == data[i]);
+		}
+		if (mapOptions.populate || mapOptions.prefaultThreads > 1)
+		{
+			ASSERT_LE(minorFaults() - faultsBefore, 1);
+		}
+
+		mmf.Prefault(4, 12345, 1u << 20);
+		mmf.Prefetch(mmf.size() - 10, 100);
+		mmf.ReadAt(&x, headerBytes, 1);
+		ASSERT_TRUE(x == data[0]);
+	}
+}
+
+TEST_F(MmapNpyTests, LoadIntoHugePages)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+
+	std::vector<std::complex<double>, mm::HugePageAllocator<std::complex<double>>> hugeData;
+	ASSERT_EQ(npypp::LoadInto("arr1.npy", hugeData), shape);
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(hugeData.data()) % mm::hugePageBytes, 0);
+	ASSERT_TRUE(std::equal(data.begin(), data.end(), hugeData.begin(), hugeData.end()));
+
+	std::vector<double, mm::HugePageAllocator<double>> wrongType;
+	ASSERT_THROW(npypp::LoadInto("arr1.npy", wrongType), std::runtime_error);
+
+	// small allocations are left to std::allocator
+	std::vector<double, mm::HugePageAllocator<double>> smallData(10, 1.0);
+	smallData.resize(mm::hugePageBytes);
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(smallData.data()) % mm::hugePageBytes, 0);
+	ASSERT_EQ(smallData[9], 1.0);
+
+	mm::HugePageAllocator<std::complex<double>> allocator;
+	ASSERT_THROW((void)allocator.allocate(allocator.max_size() + 1), std::bad_array_new_length);
+	ASSERT_THROW((void)allocator.allocate(~size_t { 0 }), std::bad_array_new_length);
+
+	mm::MapOptions options;
+	options.hugePages = true;
+	mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf("arr1.npy", 0, options);
+	ASSERT_TRUE(mmf.IsValid());
+	ASSERT_EQ(std::memcmp(mmf.GetDataAt(mmf.size() - data.size() * sizeof(data[0])), data.data(), data.size() * sizeof(data[0])), 0);
+}
+
+namespace
+{
+	/// pages of [offset, offset + nBytes) of a file in the page cache, nullopt if it can't be told
+	std::optional<size_t> ResidentPages(const std::string& fileName, size_t offset, size_t nBytes)
+	{
+#ifdef __linux__
+		nBytes += offset % mm::PageSize();
+		offset -= offset % mm::PageSize();
+		mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf(fileName);
+		std::vector<unsigned char> residency((nBytes + mm::PageSize() - 1) / mm::PageSize());
+		if (::mincore(const_cast<unsigned char*>(mmf.GetDataAt(offset)), nBytes, residency.data()) != 0)
+			return std::nullopt;
+		return static_cast<size_t>(std::count_if(residency.begin(), residency.end(), [](const unsigned char x) { return (x & 1) != 0; }));
+#else
+		(void)fileName;
+		(void)offset;
+		(void)nBytes;
+		return std::nullopt;
+#endif
+	}
+}	 // namespace
+
+TEST_F(MmapNpyTests, ReleaseBehind)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+	const size_t nBytes = data.size() * sizeof(data[0]);
+	const size_t headerBytes = npypp::detail::GetNpyHeader<std::complex<double>>(shape).size();
+	constexpr size_t releaseBehindBytes { 1u << 20 };
+
+	// the pages can only be dropped from the page cache once written back
+	bool canRelease = false;
+#ifdef __linux__
+	{
+		const int fd = ::open("arr1.npy", O_RDONLY);
+		ASSERT_GE(fd, 0);
+		::fdatasync(fd);
+		::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		::close(fd);
+		canRelease = ResidentPages("arr1.npy", 0, mm::PageSize()) == 0;
+	}
+#endif
+
+	// all but the last releaseBehindBytes (and the last batch) of the data are released, while loading
+	const auto checkReleased = [&]()
+	{
+		if (!canRelease)
+			return;
+		const size_t firstPage = (headerBytes + mm::PageSize() - 1) / mm::PageSize() * mm::PageSize();
+		ASSERT_EQ(ResidentPages("arr1.npy", firstPage, nBytes / 2), 0);
+		ASSERT_GT(ResidentPages("arr1.npy", headerBytes + nBytes - releaseBehindBytes, releaseBehindBytes), 0);
+	};
+
+	const auto loadedFile = npypp::LoadFull<std::complex<double>>("arr1.npy", false, releaseBehindBytes);
+	ASSERT_EQ(loadedFile.data, data);
+	checkReleased();
+
+	const auto loadedMapping = npypp::LoadFull<std::complex<double>>("arr1.npy", true, releaseBehindBytes);
+	ASSERT_EQ(loadedMapping.data, data);
+	checkReleased();
+
+	mm::MapOptions options;
+	options.releaseBehindBytes = releaseBehindBytes;
+	mm::WindowedMappedFile<> windowed("arr1.npy", 1u << 20, true, options);
+	windowed.Skip(headerBytes);
+	std::vector<std::complex<double>> chunk(1000);
+	size_t i = 0;
+	while (size_t nRead = windowed.Read(chunk))
+	{
+		for (size_t j = 0; j < nRead; j++)
+			ASSERT_TRUE(chunk[j] == data[i + j]);
+		i += nRead;
+	}
+	ASSERT_EQ(i, TotalSize);
+	checkReleased();
+}
+
+TEST_F(MmapNpyTests, MappingRegistry)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+	const auto headerBytes = npypp::detail::GetNpyHeader<std::complex<double>>(shape).size();
+
+	mm::MappingRegistryOptions options;
+	options.idleTimeout = std::chrono::milliseconds(20);
+	mm::MappingRegistry registry(options);
+	ASSERT_EQ(registry.Acquire("missing.npy"), nullptr);
+
+	// one mapping per file, whatever the path
+	auto region = registry.Acquire("arr1.npy");
+	ASSERT_NE(region, nullptr);
+	ASSERT_EQ(registry.Acquire("./arr1.npy"), region);
+	ASSERT_EQ(std::memcmp(region->data() + headerBytes, data.data(), data.size() * sizeof(data[0])), 0);
+	auto stats = registry.GetStats();
+	ASSERT_EQ(stats.misses, 1);
+	ASSERT_EQ(stats.hits, 1);
+	ASSERT_EQ(stats.mappings, 1);
+	ASSERT_EQ(stats.mappedBytes, region->size());
+
+	// a file rewritten in place is mapped again
+	const std::vector<size_t> newShape { Nz, Ny, 2 * Nx };
+	npypp::Save("arr1.npy", std::vector<std::complex<double>>(2 * TotalSize), newShape, "w");
+	auto newRegion = registry.Acquire("arr1.npy");
+	ASSERT_NE(newRegion, region);
+	ASSERT_GT(newRegion->size(), region->size());
+	ASSERT_EQ(registry.GetStats().stale, 1);
+	ASSERT_EQ(registry.GetStats().mappings, 1);
+
+	// a file replaced by another one is a different file
+	npypp::Save("arr2.npy", data, shape, "w");
+	ASSERT_EQ(std::rename("arr2.npy", "arr1.npy"), 0);
+	auto replacedRegion = registry.Acquire("arr1.npy");
+	ASSERT_EQ(std::memcmp(replacedRegion->data() + headerBytes, data.data(), data.size() * sizeof(data[0])), 0);
+	ASSERT_EQ(registry.GetStats().misses, 2);
+	ASSERT_EQ(registry.GetStats().mappings, 2);
+
+	// unmapped by Purge once no handle references them, whatever the timeout
+	const std::weak_ptr<const mm::MappedRegion> weakRegion = replacedRegion;
+	region.reset();
+	replacedRegion.reset();
+	registry.Purge();
+	ASSERT_TRUE(weakRegion.expired());
+	ASSERT_EQ(registry.GetStats().mappings, 1);
+	ASSERT_EQ(registry.GetStats().evictions, 1);
+
+	// and by the helper thread once idle: only the time it takes is left to the scheduler
+	const std::weak_ptr<const mm::MappedRegion> weakNewRegion = newRegion;
+	newRegion.reset();
+	for (size_t i = 0; i < 1000 && !weakNewRegion.expired(); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	ASSERT_TRUE(weakNewRegion.expired());
+	stats = registry.GetStats();
+	ASSERT_EQ(stats.mappings, 0);
+	ASSERT_EQ(stats.mappedBytes, 0);
+	ASSERT_EQ(stats.evictions, 2);
+
+	// acquired concurrently, a file ends up mapped once
+	{
+		std::vector<std::shared_ptr<const mm::MappedRegion>> regions(8);
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < regions.size(); i++)
+			threads.emplace_back([&, i]() { regions[i] = registry.Acquire("arr1.npy"); });
+		for (auto& thread : threads)
+			thread.join();
+		ASSERT_NE(regions.front(), nullptr);
+		for (const auto& acquired : regions)
+			ASSERT_EQ(acquired, regions.front());
+		ASSERT_EQ(registry.GetStats().mappings, 1);
+		ASSERT_EQ(regions.front().use_count(), static_cast<long>(regions.size()) + 1);
+	}
+	registry.Purge();
+	ASSERT_EQ(registry.GetStats().mappings, 0);
+
+#ifdef __linux__
+	// what can't be mapped isn't, rather than blocking on a FIFO or aborting on a directory
+	ASSERT_EQ(registry.Acquire("."), nullptr);
+	::unlink("fifo");
+	ASSERT_EQ(::mkfifo("fifo", 0600), 0);
+	ASSERT_EQ(registry.Acquire("fifo"), nullptr);
+	::unlink("fifo");
+	ASSERT_FALSE((mm::MemoryMappedFile<mm::CacheHint::RandomAccess>(".").IsValid()));
+#endif
+
+	// Purge doesn't wait for the timeout, and keeps what's referenced
+	mm::MappingRegistryOptions slowOptions;
+	slowOptions.idleTimeout = std::chrono::hours(1);
+	slowOptions.recheckInterval = std::chrono::hours(1);
+	mm::MappingRegistry slowRegistry(slowOptions);
+	region = slowRegistry.Acquire("arr1.npy");
+	slowRegistry.Purge();
+	ASSERT_EQ(slowRegistry.GetStats().mappings, 1);
+
+	// within recheckInterval, changes aren't looked for
+	npypp::Save("arr1.npy", data, shape, "w");
+	ASSERT_EQ(slowRegistry.Acquire("arr1.npy"), region);
+	region.reset();
+	slowRegistry.Purge();
+	ASSERT_EQ(slowRegistry.GetStats().mappings, 0);
+	ASSERT_EQ(&mm::MappingRegistry::Instance(), &mm::MappingRegistry::Instance());
+}
+
+TEST_F(MmapNpyTests, LockedMappingsAndArrays)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+	const auto lockedBytesBefore = mm::LockedBytes();
+
+	// locked, unless over RLIMIT_MEMLOCK: either way the mapping is usable, and the counters agree
+	mm::MapOptions options;
+	options.lock = true;
+	{
+		mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf("arr1.npy", 0, options);
+		ASSERT_TRUE(mmf.IsValid());
+		ASSERT_EQ(mm::LockedBytes() - lockedBytesBefore, mmf.IsLocked() ? mmf.GetMappedBytes() : 0);
+
+		mm::MappingRegistryOptions registryOptions;
+		registryOptions.mapOptions = options;
+		mm::MappingRegistry registry(registryOptions);
+		const auto region = registry.Acquire("arr1.npy");
+		ASSERT_EQ(registry.GetStats().lockedBytes, region->IsLocked() ? region->size() : 0);
+		ASSERT_EQ(std::memcmp(region->data(), mmf.GetDataAt(0), region->size()), 0);
+	}
+	ASSERT_EQ(mm::LockedBytes(), lockedBytesBefore);
+
+	// loaded arrays are locked for the lifetime of the lock
+	const auto loaded = npypp::LoadFull<std::complex<double>>("arr1.npy");
+	{
+		mm::MemoryLock lock(loaded.data.data(), loaded.data.size() * sizeof(loaded.data[0]));
+		ASSERT_EQ(mm::LockedBytes() - lockedBytesBefore, lock.GetLockedBytes());
+		if (lock.IsLocked())
+		{
+			ASSERT_EQ(lock.GetLockedBytes(), loaded.data.size() * sizeof(loaded.data[0]));
+		}
+
+		mm::MemoryLock moved(std::move(lock));
+		ASSERT_FALSE(lock.IsLocked());	  // NOLINT(bugprone-use-after-move)
+		moved.Unlock();
+		ASSERT_EQ(mm::LockedBytes(), lockedBytesBefore);
+	}
+	ASSERT_EQ(mm::LockedBytes(), lockedBytesBefore);
+}
+
+namespace
+{
+	/// NUMA policy mode of the mapping holding address (MPOL_BIND: 2, MPOL_INTERLEAVE: 3), or of the calling thread if nullptr; -1 if unsupported
+	int GetMemoryPolicy([[maybe_unused]] const void* address)
+	{
+#ifdef __linux__
+		int mode = -1;
+		constexpr unsigned long mpolFAddr { 1u << 1 };
+		if (::syscall(SYS_get_mempolicy, &mode, nullptr, 0, address, address == nullptr ? 0 : mpolFAddr) != 0)
+			return -1;
+		return mode;
+#else
+		return -1;
+#endif
+	}
+}	 // namespace
+
+TEST_F(MmapNpyTests, NumaPlacement)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+	const int threadMode = GetMemoryPolicy(nullptr);
+	const bool supported = threadMode >= 0;
+
+	// parts cover the array, at row boundaries
+	const size_t rowBytes = Ny * Nx * sizeof(data[0]);
+	for (const size_t nParts : std::initializer_list<size_t> { 1, 2, 3, 7 })
+	{
+		ASSERT_EQ(mm::NumaPartBegin(TotalSize * sizeof(data[0]), nParts, rowBytes, 0), 0);
+		ASSERT_EQ(mm::NumaPartBegin(TotalSize * sizeof(data[0]), nParts, rowBytes, nParts), TotalSize * sizeof(data[0]));
+		for (size_t i = 0; i < nParts; i++)
+			ASSERT_EQ(mm::NumaPartBegin(TotalSize * sizeof(data[0]), nParts, rowBytes, i) % rowBytes, 0);
+	}
+
+	// the array is left untouched until read into, so that the reading threads place it
+	{
+		const mm::NumaAllocator<std::complex<double>> uninitialized { mm::detail::LeaveUninitialized {} };
+		const std::vector<std::complex<double>, mm::NumaAllocator<std::complex<double>>> untouched(TotalSize, uninitialized);
+#ifdef __linux__
+		std::vector<unsigned char> residency(TotalSize * sizeof(data[0]) / mm::PageSize());
+		ASSERT_EQ(::mincore(const_cast<std::complex<double>*>(untouched.data()), residency.size() * mm::PageSize(), residency.data()), 0);
+		ASSERT_EQ(std::count_if(residency.begin(), residency.end(), [](const unsigned char page) { return (page & 1) != 0; }), 0);
+#endif
+		mm::NumaAllocator<double> allocator;
+		ASSERT_THROW((void)allocator.allocate(allocator.max_size() + 1), std::bad_array_new_length);
+
+		// otherwise it's a regular allocator: elements added by resizing are zeroed
+		std::vector<double, mm::NumaAllocator<double>> values(3, 7.0);
+		values.resize(1);
+		values.resize(3);
+		ASSERT_EQ(values[0], 7.0);
+		ASSERT_EQ(values[1], 0.0);
+		ASSERT_EQ(values[2], 0.0);
+	}
+
+	const std::map<mm::NumaPlacement, int> modes { { mm::NumaPlacement::Default, 0 }, { mm::NumaPlacement::Interleave, 3 }, { mm::NumaPlacement::Bind, 2 }, { mm::NumaPlacement::Partition, 2 } };
+	for (const auto& [placement, mode] : modes)
+	{
+		mm::NumaPolicy policy;
+		policy.placement = placement;
+		policy.node = mm::NumaNodes().front();
+
+		const auto loaded = npypp::LoadFull<std::complex<double>>("arr1.npy", policy);
+		ASSERT_EQ(loaded.shape, shape);
+		ASSERT_TRUE(std::equal(loaded.data.begin(), loaded.data.end(), data.begin(), data.end()));
+		ASSERT_EQ(reinterpret_cast<uintptr_t>(loaded.data.data()) % mm::PageSize(), 0);
+		auto resized = loaded.data;
+		resized.resize(resized.size() / 2);
+		resized.resize(loaded.data.size());
+		ASSERT_TRUE(resized.back() == std::complex<double>());
+		if (supported)
+		{
+			ASSERT_EQ(GetMemoryPolicy(loaded.data.data() + TotalSize / 2), mode);
+		}
+
+		mm::MapOptions options;
+		options.numa = policy;
+		options.prefaultThreads = 2;
+		mm::MemoryMappedFile<mm::CacheHint::RandomAccess> mmf("arr1.npy", 0, options);
+		ASSERT_TRUE(mmf.IsValid());
+		ASSERT_EQ(std::memcmp(mmf.GetDataAt(mmf.size() - data.size() * sizeof(data[0])), data.data(), data.size() * sizeof(data[0])), 0);
+		if (supported)
+		{
+			ASSERT_EQ(GetMemoryPolicy(mmf.GetDataAt(0)), mode);
+		}
+
+		// the thread policy is set for the scope only, and scopes nest
+		{
+			const mm::ThreadNumaScope scope(policy);
+			if (supported)
+			{
+				ASSERT_EQ(GetMemoryPolicy(nullptr), mode);
+			}
+			{
+				mm::NumaPolicy inner;
+				inner.placement = mm::NumaPlacement::Interleave;
+				const mm::ThreadNumaScope innerScope(inner);
+				if (supported)
+				{
+					ASSERT_EQ(GetMemoryPolicy(nullptr), 3);
+				}
+			}
+			if (supported)
+			{
+				ASSERT_EQ(GetMemoryPolicy(nullptr), placement == mm::NumaPlacement::Default ? threadMode : mode);
+			}
+		}
+		if (supported)
+		{
+			ASSERT_EQ(GetMemoryPolicy(nullptr), threadMode);
+		}
+	}
+}
+
+namespace
+{
+	/// bytes of private (copied) pages of the mapping holding address, from /proc/self/smaps
+	std::optional<size_t> PrivateBytes([[maybe_unused]] const void* address)
+	{
+#ifdef __linux__
+		std::ifstream smaps("/proc/self/smaps");
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto target = reinterpret_cast<uintptr_t>(address);
+		bool inMapping = false;
+		std::string line;
+		while (std::getline(smaps, line))
+		{
+			uintptr_t begin = 0;
+			uintptr_t end = 0;
+			char dash = 0;
+			std::istringstream range(line);
+			if (range >> std::hex >> begin >> dash >> end && dash == '-')
+				inMapping = begin <= target && target < end;
+			else if (inMapping && line.rfind("Anonymous:", 0) == 0)
+				return std::stoul(line.substr(10)) * 1024;
+		}
+#endif
+		return std::nullopt;
+	}
+}	 // namespace
+
+TEST_F(MmapNpyTests, CopyOnWriteMapping)
+{
+	npypp::Save("arr1.npy", data, shape, "w");
+
+	std::unique_ptr<npypp::WritableView<std::complex<double>>> view;
+	{
+		mm::MemoryMappedFile<mm::CacheHint::RandomAccess, mm::MapMode::CopyOnWrite> mmf("arr1.npy");
+		ASSERT_TRUE(mmf.IsValid());
+		view = std::make_unique<npypp::WritableView<std::complex<double>>>(mmf);
+		ASSERT_EQ(view->size(), TotalSize);
+		ASSERT_EQ(view->GetShape(), shape);
+		ASSERT_TRUE(std::equal(view->begin(), view->end(), data.begin()));
+
+		// until written to, pages are shared with the page cache
+		ASSERT_EQ(PrivateBytes(view->data()).value_or(0), 0);
+		(*view)[1] = { -1, -2 };
+		(*view)[TotalSize / 2] = { -3, -4 };
+		ASSERT_EQ(PrivateBytes(view->data()).value_or(2 * mm::PageSize()), 2 * mm::PageSize());
+
+		// the read-only view layer works on copy-on-write mappings too
+		const npypp::ByteSwappedView<std::complex<double>, mm::CacheHint::RandomAccess, mm::MapMode::CopyOnWrite> swappedView(mmf);
+		ASSERT_TRUE(swappedView[1] == std::complex<double>(-1, -2));
+	}
+
+	// the modifications outlive the mapping, and never reach the file
+	ASSERT_TRUE((*view)[1] == std::complex<double>(-1, -2));
+	ASSERT_TRUE((*view)[TotalSize / 2] == std::complex<double>(-3, -4));
+	ASSERT_TRUE((*view)[2] == data[2]);
+	ASSERT_EQ(npypp::LoadFull<std::complex<double>>("arr1.npy", false).data, data);
+	mm::MemoryMappedFile<mm::CacheHint::RandomAccess> readOnly("arr1.npy");
+	ASSERT_TRUE(npypp::ByteSwappedView<std::complex<double>>(readOnly)[1] == data[1]);
+
+	if (npypp::detail::SysEndianness() == '<')
+	{
+		SaveBigEndian("arr2.npy", data, shape);
+		mm::MemoryMappedFile<mm::CacheHint::RandomAccess, mm::MapMode::CopyOnWrite> foreign("arr2.npy");
+		ASSERT_THROW(npypp::WritableView<std::complex<double>> { foreign }, std::runtime_error);
+	}
+}
@@ -0,0 +1,65 @@
+#include <HugePageAllocator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	/// millions of random gathers per second from table
+	template<typename Table>
+	double GatherThroughput(const Table& table, const std::vector<size_t>& indices, double& checksum)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		double sum = 0;
+		for (const auto index : indices)
+			sum += table[index];
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		checksum += sum;
+		return static_cast<double>(indices.size()) / elapsed.count() * 1e-6;
+	}
+}	 // namespace
+
+/**
+ * Random gathers from a table of doubles (1GB by default, or 2^argv[1] elements), with 4KB pages and with transparent huge pages
+ * (mm::HugePageAllocator): the latter cut TLB misses, which dominate once the table is much larger than the TLB reach
+ */
+int main(int argc, char** argv)
+{
+	const size_t log2Elements = argc > 1 ? std::stoul(argv[1]) : 27;
+	const size_t nElements = size_t { 1 } << log2Elements;
+	constexpr size_t nGathers { size_t { 1 } << 24 };
+	constexpr size_t nRepetitions { 3 };
+
+	std::mt19937_64 generator(42);
+	std::uniform_int_distribution<size_t> distribution(0, nElements - 1);
+	std::vector<size_t> indices(nGathers);
+	for (auto& index : indices)
+		index = distribution(generator);
+
+	// the best of a few runs, after the tables were first touched by their construction
+	double checksum = 0;
+	double smallPages = 0;
+	double hugePages = 0;
+	{
+		const std::vector<double> table(nElements, 1.0);
+		for (size_t i = 0; i < nRepetitions; ++i)
+			smallPages = std::max(smallPages, GatherThroughput(table, indices, checksum));
+	}
+	{
+		const std::vector<double, mm::HugePageAllocator<double>> table(nElements, 1.0);
+		for (size_t i = 0; i < nRepetitions; ++i)
+			hugePages = std::max(hugePages, GatherThroughput(table, indices, checksum));
+	}
+
+	std::printf("table: %zu MB, %zu gathers\n", nElements * sizeof(double) >> 20, nGathers);
+	std::printf("4KB pages:  %8.1f M gathers/s\n", smallPages);
+	std::printf("huge pages: %8.1f M gathers/s (x%.2f)\n", hugePages, hugePages / smallPages);
+	std::printf("checksum: %g\n", checksum);
+	return EXIT_SUCCESS;
+}
@@ -26,8 +26,10 @@ __STOP_IGNORING_WARNINGS__
 
 #include <Npy++.h>
 
+#include <array>
 #include <complex>
 #include <cstdlib>
+#include <fstream>
 #include <map>
 
 constexpr size_t Nx { 128 };
@@ -66,6 +68,29 @@ TEST_F(NpyTests, OriginalLibraryConsistency)
 	}
 }
 
+TEST_F(NpyTests, HeaderPadding)
+{
+	// as numpy and cnpy: the 10 bytes preamble and the dictionary add up to a multiple of 16, so that the data is aligned
+	for (const auto& arrayShape : std::vector<std::vector<size_t>> { {}, { 1 }, { 7, 3 }, shape, { 123456789, 2, 5 } })
+	{
+		ASSERT_EQ(npypp::detail::GetNpyHeader<char>(arrayShape).size() % 16, 0);
+		ASSERT_EQ(npypp::detail::GetNpyHeader<float>(arrayShape).size() % 16, 0);
+		ASSERT_EQ(npypp::detail::GetNpyHeader<std::complex<double>>(arrayShape).size() % 16, 0);
+	}
+
+	// as written in files, next to cnpy's
+	npypp::Save("v.npy", data, shape, "w");
+	cnpy::npy_save("v.cnpy", data.data(), shape, "w");
+	for (const auto& fileName : { "v.npy", "v.cnpy" })
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		std::array<unsigned char, 10> preamble {};
+		ASSERT_TRUE(file.read(reinterpret_cast<char*>(preamble.data()), preamble.size()));
+		const size_t headerLength = preamble[8] | (size_t { preamble[9] } << 8);
+		ASSERT_EQ((preamble.size() + headerLength) % 16, 0);
+	}
+}
+
 TEST_F(NpyTests, ReadAndSave)
 {
 	npypp::Save("arr1.npy", data, shape, "w");
@@ -1,11 +1,45 @@
 #include "pch.h"
+
+#include "IgnoreWarning.h"
+
+#ifdef __clang__
+	#define __IGNORE_CNPY_WARNINGS                                                                                                                                                                     \
+		__IGNORE_WARNING__("-Wold-style-cast")                                                                                                                                                         \
+		__IGNORE_WARNING__("-Wzero-as-null-pointer-constant")                                                                                                                                          \
+		__IGNORE_WARNING__("-Wsign-conversion")                                                                                                                                                        \
+		__IGNORE_WARNING__("-Wcast-qual")                                                                                                                                                              \
+		__IGNORE_WARNING__("-Wshorten-64-to-32")
+#else
+	#define __IGNORE_CNPY_WARNINGS                                                                                                                                                                     \
+		__IGNORE_WARNING__("-Wold-style-cast")                                                                                                                                                         \
+		__IGNORE_WARNING__("-Wzero-as-null-pointer-constant")                                                                                                                                          \
+		__IGNORE_WARNING__("-Wsign-conversion")                                                                                                                                                        \
+		__IGNORE_WARNING__("-Wcast-qual")                                                                                                                                                              \
+		__IGNORE_WARNING__("-Weffc++")
+
+#endif
+
+__START_IGNORING_WARNINGS__
+__IGNORE_CNPY_WARNINGS
+#include "cnpy/cnpy.h"
+__STOP_IGNORING_WARNINGS__
+
 #include <Npy++.h>
+#include <MappedNpzArchive.h>
+#include <NpzArchive.h>
 
+#include <algorithm>
 #include <complex>
 #include <cstdlib>
+#include <fstream>
 #include <map>
 #include <string>
 
+#ifdef __linux__
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
 constexpr size_t Nx { 128 };
 constexpr size_t Ny { 64 };
 constexpr size_t Nz { 32 };
@@ -115,3 +149,854 @@ TEST_F(NpzTests, ReadBigEndian)
 	for (size_t i = 0; i < d.size(); i++)
 		ASSERT_EQ(d[i], i);
 }
+
+TEST_F(NpzTests, DataDescriptors)
+{
+	// written by Python's zipfile to a non-seekable stream: local headers have zero CRC and sizes (flag bit 3), which are in data descriptors
+	const std::vector<double> deflated { 0.0, 1.0, 2.0, 3.0, 4.0, 5.0 };
+	const std::vector<int> stored { 0, 1, 2, 3 };
+	npypp::NpzLoadOptions options;
+	options.verifyCrc = true;
+
+	npypp::NpzArchive archive("descriptors.npz");
+	ASSERT_EQ(archive.Names(), std::vector<std::string>({ "deflated", "stored", "zip64" }));
+	for (const auto& info : archive.Members())
+		ASSERT_TRUE(info.flags & 0x08);
+	ASSERT_EQ(archive.Load<double>("deflated", options).shape, std::vector<size_t>({ 2, 3 }));
+	ASSERT_EQ(archive.Load<double>("deflated", options).data, deflated);
+	ASSERT_EQ(archive.Load<int>("stored", options).data, stored);
+	ASSERT_EQ(archive.Load<int16_t>("zip64", options).data, std::vector<int16_t>({ -1, 0, 1 }));
+	ASSERT_EQ(npypp::LoadCompressedFull<double>("descriptors.npz", "deflated", options).data, deflated);
+
+	const npypp::MappedNpzArchive<> mappedArchive("descriptors.npz");
+	const auto view = mappedArchive.View<int>("stored", options);
+	ASSERT_EQ(std::vector<int>(view.begin(), view.end()), stored);
+	ASSERT_EQ(mappedArchive.View<double>("deflated", options).size(), deflated.size());
+
+	// the descriptors are dropped by compaction, as the local headers get the sizes
+	{
+		std::ifstream src("descriptors.npz", std::ios::binary);
+		std::ofstream dst("out.npz", std::ios::binary);
+		dst << src.rdbuf();
+	}
+	npypp::NpzArchive copy("out.npz");
+	ASSERT_GT(copy.GetUnreferencedBytes(), 0);
+	copy.Compact();
+	ASSERT_EQ(copy.GetUnreferencedBytes(), 0);
+	for (const auto& info : copy.Members())
+		ASSERT_FALSE(info.flags & 0x08);
+	ASSERT_EQ(npypp::NpzArchive("out.npz").Load<int>("stored", options).data, stored);
+}
+
+namespace
+{
+	size_t FileSize(const std::string& fileName) { return static_cast<size_t>(std::ifstream(fileName, std::ios::binary | std::ios::ate).tellg()); }
+}	 // namespace
+
+TEST_F(NpzTests, DeflateIsSmallerThanStored)
+{
+	// sparse data, as in gradients
+	std::vector<double> sparse(TotalSize, 0.0);
+	for (size_t i = 0; i < TotalSize; i += 64)
+		sparse[i] = data[i].real();
+
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+	npypp::SaveCompressed("stored.npz", "arr1", sparse, shape, "w", stored);
+	npypp::SaveCompressed("deflated.npz", "arr1", sparse, shape, "w");
+	ASSERT_LT(3 * FileSize("deflated.npz"), FileSize("stored.npz"));
+
+	for (const auto* fileName : { "stored.npz", "deflated.npz" })
+	{
+		auto loadedData = npypp::LoadCompressedFull<double>(fileName, "arr1");
+		ASSERT_EQ(loadedData.shape, shape);
+		ASSERT_EQ(loadedData.data, sparse);
+	}
+}
+
+TEST_F(NpzTests, DeflateLevelsAndStrategies)
+{
+	for (const auto strategy : { npypp::CompressionStrategy::Default, npypp::CompressionStrategy::Filtered, npypp::CompressionStrategy::HuffmanOnly,
+								 npypp::CompressionStrategy::Rle, npypp::CompressionStrategy::Fixed })
+	{
+		for (const int level : { 1, 9 })
+		{
+			npypp::CompressionOptions options;
+			options.level = level;
+			options.strategy = strategy;
+			npypp::SaveCompressed("out.npz", "arr1", data, shape, "w", options);
+			npypp::SaveCompressed("out.npz", "arr2", data, shape, "a", options);
+
+			auto dataDictionary = npypp::LoadCompressed<std::complex<double>>("out.npz");
+			ASSERT_EQ(dataDictionary["arr1"], data);
+			ASSERT_EQ(dataDictionary["arr2"], data);
+		}
+	}
+}
+
+TEST_F(NpzTests, DeflateOriginalLibraryConsistency)
+{
+	npypp::SaveCompressed("out.npz", "arr1", data, shape, "w");
+
+	const auto array = cnpy::npz_load("out.npz", "arr1");
+	ASSERT_EQ(array.shape, shape);
+	const auto loadedData = array.as_vec<std::complex<double>>();
+	ASSERT_EQ(loadedData, data);
+}
+
+TEST_F(NpzTests, ParallelDeflate)
+{
+	npypp::CompressionOptions serial;
+	npypp::SaveCompressed("serial.npz", "arr1", data, shape, "w", serial);
+
+	for (const size_t nThreads : { 0ul, 2ul, 4ul })
+	{
+		npypp::CompressionOptions options;
+		options.nThreads = nThreads;
+		options.blockBytes = 1u << 16;
+		npypp::SaveCompressed("out.npz", "arr1", data, shape, "w", options);
+		npypp::SaveCompressed("out.npz", "arr2", data, shape, "a", options);
+
+		auto dataDictionary = npypp::LoadCompressed<std::complex<double>>("out.npz");
+		ASSERT_EQ(dataDictionary["arr1"], data);
+		ASSERT_EQ(dataDictionary["arr2"], data);
+
+		// priming each block with the previous one's tail keeps the ratio close to the serial one
+		ASSERT_LT(FileSize("out.npz"), 2 * FileSize("serial.npz") * 21 / 20);
+
+		auto arrays = cnpy::npz_load("out.npz");
+		ASSERT_EQ(arrays["arr2"].as_vec<std::complex<double>>(), data);
+	}
+}
+
+TEST_F(NpzTests, WriteErrors)
+{
+#ifdef __linux__
+	// every write to /dev/full fails with ENOSPC, once the stdio buffer is flushed
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+	npypp::CompressionOptions parallel;
+	parallel.nThreads = 2;
+	parallel.blockBytes = 1u << 16;
+	for (const auto& options : { stored, npypp::CompressionOptions {}, parallel })
+		ASSERT_THROW(npypp::SaveCompressed("/dev/full", "arr1", data, shape, "w", options), std::runtime_error);
+#endif
+}
+
+TEST_F(NpzTests, ParallelForOutOfThreads)
+{
+#if defined(__linux__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+	// without address space left for their stacks, most threads can't be started
+	std::ifstream statm("/proc/self/statm");
+	size_t nPages = 0;
+	statm >> nPages;
+	rlimit limit {};
+	ASSERT_EQ(getrlimit(RLIMIT_AS, &limit), 0);
+	const rlimit tight { nPages * static_cast<size_t>(sysconf(_SC_PAGESIZE)) + (1u << 20), limit.rlim_max };
+	ASSERT_EQ(setrlimit(RLIMIT_AS, &tight), 0);
+
+	std::vector<size_t> nRuns(1024, 0);
+	npypp::detail::ParallelFor(nRuns.size(), 64, [&](const size_t i) { ++nRuns[i]; });
+	bool thrown = false;
+	try
+	{
+		npypp::detail::ParallelFor(nRuns.size(), 64, [](const size_t i) { if (i == 100) throw std::runtime_error("task"); });
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	ASSERT_EQ(setrlimit(RLIMIT_AS, &limit), 0);
+
+	ASSERT_EQ(std::count(nRuns.begin(), nRuns.end(), 1), static_cast<std::ptrdiff_t>(nRuns.size()));
+	ASSERT_TRUE(thrown);
+#endif
+}
+
+TEST_F(NpzTests, Crc32MatchesZlib)
+{
+	const auto* buffer = reinterpret_cast<const unsigned char*>(data.data());
+	for (const size_t offset : { 0ul, 1ul, 7ul })
+	{
+		for (const size_t nBytes : { 0ul, 15ul, 64ul, 65ul, 127ul, 1000ul, 123457ul })
+		{
+			const auto expected = static_cast<uint32_t>(crc32(0, buffer + offset, static_cast<uInt>(nBytes)));
+			ASSERT_EQ(npypp::detail::Crc32(0, buffer + offset, nBytes), expected);
+			ASSERT_EQ(npypp::detail::ParallelCrc32(0, buffer + offset, nBytes, 4, 1000), expected);
+		}
+	}
+
+	// continuing from a previous checksum
+	const auto expected = static_cast<uint32_t>(crc32(0, buffer, 1000));
+	ASSERT_EQ(npypp::detail::Crc32(npypp::detail::Crc32(0, buffer, 300), buffer + 300, 700), expected);
+}
+
+TEST_F(NpzTests, VerifyCrcOnLoad)
+{
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+	npypp::SaveCompressed("stored.npz", "arr1", data, shape, "w", stored);
+	npypp::SaveCompressed("deflated.npz", "arr1", data, shape, "w");
+
+	npypp::NpzLoadOptions options;
+	options.verifyCrc = true;
+	ASSERT_EQ(npypp::LoadCompressed<std::complex<double>>("stored.npz", "arr1"), data);
+	ASSERT_EQ(npypp::LoadCompressedFull<std::complex<double>>("stored.npz", "arr1", options).data, data);
+	ASSERT_EQ(npypp::LoadCompressedFull<std::complex<double>>("deflated.npz", "arr1", options).data, data);
+	ASSERT_EQ(npypp::LoadCompressedFull<uint16_t>("0123.npz", options).size(), 1);
+
+	// corrupt one byte of the stored data
+	FILE* fp = std::fopen("stored.npz", "r+b");
+	ASSERT_NE(fp, nullptr);
+	std::fseek(fp, 1000, SEEK_SET);
+	const int c = std::fgetc(fp);
+	std::fseek(fp, 1000, SEEK_SET);
+	std::fputc(c ^ 0xFF, fp);
+	std::fclose(fp);
+
+	ASSERT_NO_THROW(npypp::LoadCompressedFull<std::complex<double>>("stored.npz"));
+	ASSERT_THROW(npypp::LoadCompressedFull<std::complex<double>>("stored.npz", options), std::runtime_error);
+}
+
+TEST_F(NpzTests, Zip64)
+{
+	for (const auto method : { npypp::CompressionMethod::Stored, npypp::CompressionMethod::Deflate })
+	{
+		npypp::CompressionOptions options;
+		options.method = method;
+		options.forceZip64 = true;
+		npypp::SaveCompressed("out.npz", "arr1", data, shape, "w", options);
+		npypp::SaveCompressed("out.npz", "arr2", data, shape, "a", options);
+		// appending without zip64 records keeps the previous zip64 entries readable
+		options.forceZip64 = false;
+		npypp::SaveCompressed("out.npz", "arr3", data, shape, "a", options);
+
+		npypp::NpzLoadOptions loadOptions;
+		loadOptions.verifyCrc = true;
+		auto dataDictionary = npypp::LoadCompressedFull<std::complex<double>>("out.npz", loadOptions);
+		ASSERT_EQ(dataDictionary.size(), 3);
+		for (const auto* name : { "arr1", "arr2", "arr3" })
+		{
+			ASSERT_EQ(dataDictionary[name].shape, shape);
+			ASSERT_EQ(dataDictionary[name].data, data);
+		}
+	}
+}
+
+TEST_F(NpzTests, Zip64Records)
+{
+	npypp::detail::ZipEntry entry;
+	entry.name = "arr1.npy";
+	entry.zip64 = true;
+	entry.uncompressedBytes = 5ull << 30;
+	entry.compressedBytes = 3ull << 30;
+	entry.localHeaderOffset = 6ull << 30;
+
+	const auto localHeader = npypp::detail::GetLocalHeader(entry);
+	ASSERT_EQ(localHeader.size(), npypp::detail::localHeaderSize + entry.name.size() + 20);
+	uint64_t uncompressedBytes = npypp::detail::readBytes<uint32_t>(&localHeader[22]);
+	uint64_t compressedBytes = npypp::detail::readBytes<uint32_t>(&localHeader[18]);
+	npypp::detail::ParseZip64ExtraField(&localHeader[30 + entry.name.size()], 20, uncompressedBytes, compressedBytes);
+	ASSERT_EQ(uncompressedBytes, entry.uncompressedBytes);
+	ASSERT_EQ(compressedBytes, entry.compressedBytes);
+
+	// central directory stores the offset as well
+	std::string globalHeader;
+	npypp::detail::AppendGlobalHeader(globalHeader, entry);
+	uncompressedBytes = npypp::detail::readBytes<uint32_t>(&globalHeader[24]);
+	compressedBytes = npypp::detail::readBytes<uint32_t>(&globalHeader[20]);
+	uint64_t localHeaderOffset = npypp::detail::readBytes<uint32_t>(&globalHeader[42]);
+	const auto extraFieldsLength = npypp::detail::readBytes<uint16_t>(&globalHeader[30]);
+	ASSERT_EQ(extraFieldsLength, 28);
+	npypp::detail::ParseZip64ExtraField(&globalHeader[46 + entry.name.size()], extraFieldsLength, uncompressedBytes, compressedBytes, &localHeaderOffset);
+	ASSERT_EQ(uncompressedBytes, entry.uncompressedBytes);
+	ASSERT_EQ(compressedBytes, entry.compressedBytes);
+	ASSERT_EQ(localHeaderOffset, entry.localHeaderOffset);
+
+	// values past the declared size of the field are rejected, rather than read from what follows it
+	std::string truncatedField;
+	npypp::detail::appendBytes<uint16_t>(truncatedField, npypp::detail::zip64ExtraFieldId);
+	npypp::detail::appendBytes<uint16_t>(truncatedField, 4);
+	npypp::detail::appendBytes<uint64_t>(truncatedField, entry.uncompressedBytes);
+	uncompressedBytes = npypp::detail::zip64Marker32;
+	compressedBytes = 0;
+	ASSERT_THROW(npypp::detail::ParseZip64ExtraField(truncatedField.data(), truncatedField.size(), uncompressedBytes, compressedBytes), std::runtime_error);
+
+	// more than 65535 records require the zip64 footer
+	ASSERT_EQ(npypp::detail::GetNpzFooter(65534, 100, 100).size(), npypp::detail::footerSize);
+	ASSERT_EQ(npypp::detail::GetNpzFooter(70000, 100, 100).size(), npypp::detail::footerSize + npypp::detail::zip64FooterSize + npypp::detail::zip64LocatorSize);
+}
+
+TEST_F(NpzTests, Zip64LargeOffsets)
+{
+	// an empty archive whose central directory starts past 4GB, after a hole: members appended to it are at 64 bits offsets
+	const uint64_t offset = 5ull << 30;
+	{
+		FILE* fp = std::fopen("big.npz", "wb");
+		ASSERT_NE(fp, nullptr);
+		const std::string footer = npypp::detail::GetNpzFooter(0, 0, offset, true);
+		ASSERT_TRUE(npypp::detail::TruncateFile(fp, offset));
+		ASSERT_TRUE(npypp::detail::Seek(fp, static_cast<int64_t>(offset), SEEK_SET));
+		npypp::detail::WriteBytes(fp, footer.data(), footer.size());
+		ASSERT_EQ(npypp::detail::Tell(fp), static_cast<int64_t>(offset + footer.size()));
+		std::fclose(fp);
+	}
+
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+	{
+		npypp::NpzWriter writer("big.npz", "a");
+		writer.Write("arr1", data, shape, stored);
+		writer.Write("arr2", data, shape);
+		writer.Close();
+	}
+
+	npypp::NpzLoadOptions loadOptions;
+	loadOptions.verifyCrc = true;
+	auto dataDictionary = npypp::LoadCompressedFull<std::complex<double>>("big.npz", loadOptions);
+	ASSERT_EQ(dataDictionary.size(), 2);
+	ASSERT_EQ(dataDictionary["arr1"].data, data);
+	ASSERT_EQ(dataDictionary["arr2"].data, data);
+
+	npypp::NpzArchive archive("big.npz");
+	ASSERT_GT(archive.Info("arr2").localHeaderOffset, offset);
+	std::reverse(data.begin(), data.end());
+	archive.Replace("arr1", data, shape);
+	ASSERT_EQ(npypp::LoadCompressedFull<std::complex<double>>("big.npz", "arr1", loadOptions).data, data);
+
+	std::remove("big.npz");
+}
+
+TEST_F(NpzTests, ArchiveIndex)
+{
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+	npypp::SaveCompressed("out.npz", "weights.0", data, shape, "w");
+	npypp::SaveCompressed("out.npz", "weights.1", data, shape, "a", stored);
+	npypp::SaveCompressed("out.npz", "bias", data, { TotalSize }, "a");
+
+	npypp::NpzArchive archive("out.npz");
+	ASSERT_EQ(archive.size(), 3);
+	ASSERT_EQ(archive.Names(), std::vector<std::string>({ "weights.0", "weights.1", "bias" }));
+	ASSERT_TRUE(archive.Contains("bias"));
+	ASSERT_FALSE(archive.Contains("bias.npy"));
+	ASSERT_THROW(static_cast<void>(archive.Info("missing")), std::out_of_range);
+
+	const auto& info = archive.Info("weights.1");
+	ASSERT_TRUE(info.IsStored());
+	ASSERT_EQ(info.compressedBytes, info.uncompressedBytes);
+	ASSERT_GT(info.localHeaderOffset, 0);
+	ASSERT_FALSE(archive.Info("weights.0").IsStored());
+
+	ASSERT_EQ(archive.Glob("weights.*"), std::vector<std::string>({ "weights.0", "weights.1" }));
+	ASSERT_EQ(archive.Glob("?ias"), std::vector<std::string>({ "bias" }));
+	ASSERT_TRUE(archive.Glob("*.npy").empty());
+	ASSERT_EQ(archive.Select([](const npypp::NpzMemberInfo& member) { return member.IsStored(); }), std::vector<std::string>({ "weights.1" }));
+
+	npypp::NpzLoadOptions options;
+	options.verifyCrc = true;
+	for (const auto& name : archive.Names())
+	{
+		const auto array = archive.Load<std::complex<double>>(name, options);
+		ASSERT_EQ(array.data, data);
+	}
+	ASSERT_EQ(archive.Load<std::complex<double>>("bias").shape, std::vector<size_t>({ TotalSize }));
+
+	const auto weights = archive.Load<std::complex<double>>(archive.Glob("weights.*"));
+	ASSERT_EQ(weights.size(), 2);
+	ASSERT_EQ(weights.at("weights.0").shape, shape);
+}
+
+TEST_F(NpzTests, LoadSingleMember)
+{
+	npypp::SaveCompressed("out.npz", "arr1", data, shape, "w");
+	npypp::SaveCompressed("out.npz", "arr2", std::vector<std::complex<double>>(data.rbegin(), data.rend()), shape, "a");
+
+	const auto array = npypp::LoadCompressedFull<std::complex<double>>("out.npz", "arr2");
+	ASSERT_EQ(array.shape, shape);
+	ASSERT_EQ(array.data, std::vector<std::complex<double>>(data.rbegin(), data.rend()));
+
+	ASSERT_TRUE(npypp::LoadCompressedFull<std::complex<double>>("out.npz", "arr3").data.empty());
+
+	// archive written by numpy
+	npypp::NpzArchive archive("0123.npz");
+	ASSERT_EQ(archive.Names(), std::vector<std::string>({ "x" }));
+	ASSERT_EQ(archive.Load<uint16_t>("x").data, std::vector<uint16_t>({ 0, 1, 2, 3 }));
+}
+
+TEST(StringUtilities, GlobMatch)
+{
+	ASSERT_TRUE(utils::GlobMatch("*", ""));
+	ASSERT_TRUE(utils::GlobMatch("layer*.weight", "layer12.weight"));
+	ASSERT_TRUE(utils::GlobMatch("a*b*c", "aXbYbZc"));
+	ASSERT_TRUE(utils::GlobMatch("a?c", "abc"));
+	ASSERT_FALSE(utils::GlobMatch("a?c", "ac"));
+	ASSERT_FALSE(utils::GlobMatch("layer*.weight", "layer12.bias"));
+	ASSERT_FALSE(utils::GlobMatch("", "a"));
+}
+
+TEST_F(NpzTests, MappedArchive)
+{
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+
+	// names of different lengths shift the data offsets, so that some of them end up aligned
+	std::vector<std::string> names;
+	for (size_t i = 1; i <= 16; ++i)
+	{
+		names.push_back(std::string(i, 'a'));
+		npypp::SaveCompressed("out.npz", names.back(), data, shape, i == 1 ? "w" : "a", stored);
+	}
+	npypp::SaveCompressed("out.npz", "deflated", data, shape, "a");
+
+	const size_t npyHeaderSize = npypp::detail::GetNpyHeader<std::complex<double>>(shape).size();
+	const auto isAligned = [&](const auto& archive, const std::string& name) { return (archive.GetDataOffset(archive.Info(name)) + npyHeaderSize) % alignof(std::complex<double>) == 0; };
+
+	npypp::MappedArray<std::complex<double>> view;
+	{
+		const npypp::MappedNpzArchive<> archive("out.npz");
+		ASSERT_EQ(archive.size(), names.size() + 1);
+
+		npypp::NpzLoadOptions options;
+		options.verifyCrc = true;
+		size_t nZeroCopy = 0;
+		for (const auto& name : names)
+		{
+			const auto array = archive.View<std::complex<double>>(name, options);
+			ASSERT_EQ(array.GetShape(), shape);
+			ASSERT_TRUE(std::equal(array.begin(), array.end(), data.begin(), data.end()));
+
+			ASSERT_EQ(array.IsZeroCopy(), isAligned(archive, name));
+			nZeroCopy += array.IsZeroCopy();
+		}
+		ASSERT_GT(nZeroCopy, 0);
+
+		const auto deflated = archive.View<std::complex<double>>("deflated", options);
+		ASSERT_FALSE(deflated.IsZeroCopy());
+		ASSERT_TRUE(std::equal(deflated.begin(), deflated.end(), data.begin(), data.end()));
+
+		for (const auto& name : names)
+			if (isAligned(archive, name))
+				view = archive.View<std::complex<double>>(name);
+	}
+
+	// the view keeps the mapping alive
+	ASSERT_TRUE(view.IsZeroCopy());
+	ASSERT_TRUE(std::equal(view.begin(), view.end(), data.begin(), data.end()));
+}
+
+TEST_F(NpzTests, AlignedMembers)
+{
+	npypp::CompressionOptions aligned;
+	aligned.method = npypp::CompressionMethod::Stored;
+	aligned.alignment = 64;
+	npypp::CompressionOptions pageAligned = aligned;
+	pageAligned.alignment = 4096;
+	npypp::CompressionOptions deflated;
+	deflated.alignment = 64;
+	{
+		npypp::NpzWriter writer("out.npz");
+		for (size_t i = 1; i <= 8; ++i)
+			writer.Write(std::string(i, 'a'), data, shape, aligned);
+		writer.Write("page", data, shape, pageAligned);
+		writer.Write("deflated", data, shape, deflated);
+		writer.BeginMember<float>("streamed", { 3 }, aligned);
+		writer.Write(std::vector<float> { 1.0f, 2.0f, 3.0f });
+		writer.EndMember();
+	}
+
+	const size_t npyHeaderSize = npypp::detail::GetNpyHeader<std::complex<double>>(shape).size();
+	const auto checkAlignment = [&]()
+	{
+		const npypp::MappedNpzArchive<> archive("out.npz");
+		npypp::NpzLoadOptions options;
+		options.verifyCrc = true;
+		for (const auto& name : archive.Glob("a*"))
+		{
+			ASSERT_EQ((archive.GetDataOffset(archive.Info(name)) + npyHeaderSize) % 64, 0);
+			const auto view = archive.View<std::complex<double>>(name, options);
+			ASSERT_TRUE(view.IsZeroCopy());
+			ASSERT_TRUE(std::equal(view.begin(), view.end(), data.begin(), data.end()));
+		}
+		ASSERT_EQ((archive.GetDataOffset(archive.Info("page")) + npyHeaderSize) % 4096, 0);
+		ASSERT_TRUE(archive.View<std::complex<double>>("page", options).IsZeroCopy());
+		ASSERT_TRUE(archive.View<float>("streamed", options).IsZeroCopy());
+
+		const auto view = archive.View<std::complex<double>>("deflated", options);
+		ASSERT_TRUE(std::equal(view.begin(), view.end(), data.begin(), data.end()));
+	};
+	checkAlignment();
+
+	// shift the members, and repack them
+	npypp::NpzArchive archive("out.npz");
+	ASSERT_EQ(archive.GetAlignment(archive.Info("page")), 4096);
+	ASSERT_EQ(archive.GetAlignment(archive.Info("deflated")), 0);
+	ASSERT_TRUE(archive.Remove("a"));
+	archive.Compact();
+	ASSERT_EQ(archive.GetAlignment(archive.Info("aa")), 64);
+	checkAlignment();
+
+	aligned.alignment = 3;
+	ASSERT_THROW(npypp::SaveCompressed("out.npz", "a", data, shape, "w", aligned), std::runtime_error);
+}
+
+TEST_F(NpzTests, LoadRows)
+{
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+	{
+		npypp::NpzWriter writer("out.npz");
+		writer.Write("deflated", data, shape);
+		writer.Write("stored", data, shape, stored);
+	}
+	std::remove("out.npz.zran");
+
+	const size_t rowSize = Ny * Nx;
+	const auto check = [&](const npypp::NpzArchive& archive, const std::string& name, const size_t firstRow, const size_t nRows, const npypp::NpzLoadOptions& options)
+	{
+		const auto rows = archive.LoadRows<std::complex<double>>(name, firstRow, nRows, options);
+		ASSERT_EQ(rows.shape, std::vector<size_t>({ nRows, Ny, Nx }));
+		ASSERT_TRUE(std::equal(rows.data.begin(), rows.data.end(), data.begin() + static_cast<std::ptrdiff_t>(firstRow * rowSize), data.begin() + static_cast<std::ptrdiff_t>((firstRow + nRows) * rowSize)));
+	};
+
+	npypp::NpzLoadOptions options;
+	options.verifyCrc = true;
+	options.checkpointBytes = 1u << 16;
+	options.indexFileName = "out.npz.zran";
+	{
+		const npypp::NpzArchive archive("out.npz");
+		for (const auto& name : { "deflated", "stored" })
+		{
+			check(archive, name, 0, Nz, {});
+			check(archive, name, 5, 1, {});
+			for (size_t firstRow = 0; firstRow < Nz; firstRow += 7)
+				check(archive, name, firstRow, std::min<size_t>(3, Nz - firstRow), options);
+			check(archive, name, Nz - 1, 1, options);
+			check(archive, name, Nz, 0, options);
+			ASSERT_THROW((void)archive.LoadRows<std::complex<double>>(name, Nz - 1, 2), std::out_of_range);
+		}
+	}
+	ASSERT_GT(FileSize("out.npz.zran"), 0);
+
+	// the cached index is read back, and rebuilt once the member changes
+	{
+		npypp::NpzArchive archive("out.npz");
+		check(archive, "deflated", 17, 4, options);
+		std::reverse(data.begin(), data.end());
+		archive.Replace("deflated", data, shape);
+		check(archive, "deflated", 17, 4, options);
+	}
+
+	// a corrupt cache is ignored
+	{
+		FILE* fp = std::fopen("out.npz.zran", "r+b");
+		ASSERT_NE(fp, nullptr);
+		std::fseek(fp, 12, SEEK_SET);
+		std::fputc(0xFF, fp);
+		std::fclose(fp);
+	}
+	check(npypp::NpzArchive("out.npz"), "deflated", 30, 2, options);
+
+	// an index built with another checkpoint spacing isn't reused
+	npypp::NpzLoadOptions sparseOptions = options;
+	sparseOptions.checkpointBytes = 1u << 20;
+	const auto sparseIndex = npypp::NpzArchive("out.npz").GetAccessIndex("deflated", sparseOptions);
+	ASSERT_EQ(sparseIndex->checkpointBytes, sparseOptions.checkpointBytes);
+
+	// rows are inflated from the checkpoint before them: corrupting the stream before it doesn't affect them
+	const npypp::NpzArchive archive("out.npz");
+	const auto index = archive.GetAccessIndex("deflated", options);
+	ASSERT_EQ(index->checkpointBytes, options.checkpointBytes);
+	ASSERT_GT(index->checkpoints.size(), 8);
+	ASSERT_LT(index->checkpoints.size(), sparseIndex->checkpoints.size() * 32);
+	const auto& checkpoint = index->checkpoints[index->checkpoints.size() / 2];
+	const size_t firstRow = checkpoint.uncompressedOffset / (rowSize * sizeof(data[0])) + 1;
+	{
+		FILE* fp = std::fopen("out.npz", "r+b");
+		ASSERT_NE(fp, nullptr);
+		ASSERT_TRUE(npypp::detail::Seek(fp, static_cast<int64_t>(archive.GetDataOffset(archive.Info("deflated")) + checkpoint.compressedOffset / 2), SEEK_SET));
+		const std::vector<char> garbage(1024, '\xFF');
+		std::fwrite(garbage.data(), sizeof(char), garbage.size(), fp);
+		std::fclose(fp);
+	}
+	check(npypp::NpzArchive("out.npz"), "deflated", firstRow, 2, options);
+	ASSERT_ANY_THROW((void)npypp::NpzArchive("out.npz").Load<std::complex<double>>("deflated", options));
+}
+
+TEST_F(NpzTests, IndependentBlocks)
+{
+	npypp::CompressionOptions blocks;
+	blocks.fullFlushBytes = 1u << 16;
+	npypp::CompressionOptions parallelBlocks = blocks;
+	parallelBlocks.nThreads = 4;
+	npypp::CompressionOptions smallBlocks;
+	smallBlocks.fullFlushBytes = 64;
+	{
+		npypp::NpzWriter writer("out.npz");
+		writer.Write("serial", data, shape, blocks);
+		writer.Write("parallel", data, shape, parallelBlocks);
+		writer.Write("coarsened", data, shape, smallBlocks);
+		writer.Write("plain", data, shape);
+	}
+	// the block tables are kept by the central directory rewrites
+	npypp::SaveCompressed("out.npz", "floats", std::vector<float> { 1.0f, 2.0f }, { 2 }, "a", blocks);
+
+	const size_t memberSize = npypp::detail::GetNpyHeader<std::complex<double>>(shape).size() + data.size() * sizeof(std::complex<double>);
+	const auto check = [&](const npypp::NpzArchive& archive)
+	{
+		for (const auto& name : { "serial", "parallel" })
+		{
+			ASSERT_EQ(archive.Info(name).blockBytes, blocks.fullFlushBytes);
+			ASSERT_EQ(archive.Info(name).blockOffsets.size(), (memberSize - 1) / blocks.fullFlushBytes);
+		}
+		ASSERT_LE(archive.Info("coarsened").blockOffsets.size(), npypp::detail::maxBlockOffsets);
+		ASSERT_GT(archive.Info("coarsened").blockBytes, smallBlocks.fullFlushBytes);
+		ASSERT_TRUE(archive.Info("plain").blockOffsets.empty());
+		// too small to have more than one block
+		ASSERT_TRUE(archive.Info("floats").blockOffsets.empty());
+
+		npypp::NpzLoadOptions options;
+		options.verifyCrc = true;
+		options.nThreads = 4;
+		for (const auto& name : { "serial", "parallel", "coarsened", "plain" })
+		{
+			ASSERT_EQ(archive.Load<std::complex<double>>(name, options).data, data);
+
+			const auto rows = archive.LoadRows<std::complex<double>>(name, 9, 2);
+			ASSERT_TRUE(std::equal(rows.data.begin(), rows.data.end(), data.begin() + static_cast<std::ptrdiff_t>(9 * Ny * Nx)));
+		}
+	};
+	check(npypp::NpzArchive("out.npz"));
+
+	// offsets are relative to the member's data, so they stay valid when members move
+	npypp::NpzArchive archive("out.npz");
+	archive.Replace("serial", data, shape, blocks);
+	archive.Compact();
+	check(archive);
+}
+
+TEST_F(NpzTests, ParallelLoad)
+{
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+
+	constexpr size_t nMembers { 12 };
+	std::vector<std::vector<std::complex<double>>> arrays;
+	for (size_t i = 0; i < nMembers; ++i)
+	{
+		arrays.emplace_back(data.begin() + static_cast<std::ptrdiff_t>(i), data.end());
+		npypp::SaveCompressed("out.npz", "arr" + std::to_string(i), arrays.back(), { arrays.back().size() }, i == 0 ? "w" : "a", i % 3 == 0 ? stored : npypp::CompressionOptions {});
+	}
+
+	npypp::NpzLoadOptions options;
+	options.verifyCrc = true;
+	options.nThreads = 4;
+	const auto dataDictionary = npypp::LoadCompressedFull<std::complex<double>>("out.npz", options);
+	ASSERT_EQ(dataDictionary.size(), nMembers);
+	for (size_t i = 0; i < nMembers; ++i)
+	{
+		const auto& array = dataDictionary.at("arr" + std::to_string(i));
+		ASSERT_EQ(array.shape, std::vector<size_t>({ arrays[i].size() }));
+		ASSERT_EQ(array.data, arrays[i]);
+	}
+
+	// ordered by name, whatever the completion order
+	ASSERT_TRUE(std::is_sorted(dataDictionary.begin(), dataDictionary.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; }));
+}
+
+TEST_F(NpzTests, StreamingInflate)
+{
+	// raw deflate stream of the test data
+	std::vector<unsigned char> compressed(compressBound(static_cast<uLong>(data.size() * sizeof(data[0]))));
+	z_stream stream {};
+	ASSERT_EQ(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY), Z_OK);
+	stream.next_in = reinterpret_cast<Bytef*>(data.data());	   // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	stream.avail_in = static_cast<uInt>(data.size() * sizeof(data[0]));
+	stream.next_out = compressed.data();
+	stream.avail_out = static_cast<uInt>(compressed.size());
+	ASSERT_EQ(deflate(&stream, Z_FINISH), Z_STREAM_END);
+	compressed.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	// odd sized reads, with the CRC computed on the fly
+	{
+		npypp::detail::MemberReader reader(compressed.data(), compressed.size(), true);
+		std::vector<std::complex<double>> inflated(data.size());
+		auto* out = reinterpret_cast<unsigned char*>(inflated.data());	  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		const size_t nBytes = inflated.size() * sizeof(inflated[0]);
+		for (size_t position = 0; position < nBytes; position += 12345)
+			reader.Read(out + position, std::min<size_t>(12345, nBytes - position));
+		reader.Finish();
+		ASSERT_EQ(inflated, data);
+		ASSERT_EQ(reader.GetCrc(), npypp::detail::Crc32(0, data.data(), nBytes));
+	}
+
+	std::vector<std::complex<double>> inflated(data.size() + 1);
+	{
+		npypp::detail::MemberReader reader(compressed.data(), compressed.size() / 2);
+		ASSERT_THROW(reader.Read(inflated.data(), data.size() * sizeof(data[0])), std::runtime_error);
+	}
+	{
+		npypp::detail::MemberReader reader(compressed.data(), compressed.size());
+		ASSERT_THROW(reader.Read(inflated.data(), inflated.size() * sizeof(data[0])), std::runtime_error);
+	}
+	{
+		npypp::detail::MemberReader reader(compressed.data(), compressed.size());
+		reader.Read(inflated.data(), (data.size() - 1) * sizeof(data[0]));
+		ASSERT_THROW(reader.Finish(), std::runtime_error);
+	}
+}
+
+TEST_F(NpzTests, Writer)
+{
+	const std::vector<float> floats { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+	const std::vector<int64_t> integers { -1, 0, 1 };
+	{
+		npypp::NpzWriter writer("out.npz");
+		writer.Write("complex", data, shape);
+		writer.Write("floats", floats, { 2, 3 });
+		npypp::CompressionOptions stored;
+		stored.method = npypp::CompressionMethod::Stored;
+		writer.Write("integers", integers, { integers.size() }, stored);
+		ASSERT_EQ(writer.size(), 3);
+		// central directory is written by the destructor
+	}
+	{
+		npypp::NpzWriter writer("out.npz", FileOpenMode::Append);
+		ASSERT_EQ(writer.size(), 3);
+		for (size_t i = 0; i < 100; ++i)
+			writer.Write("member" + std::to_string(i), std::vector<uint8_t>(i, static_cast<uint8_t>(i)), { i });
+		writer.Close();
+		ASSERT_FALSE(writer.IsOpen());
+	}
+
+	npypp::NpzArchive archive("out.npz");
+	ASSERT_EQ(archive.size(), 103);
+	npypp::NpzLoadOptions options;
+	options.verifyCrc = true;
+	ASSERT_EQ(archive.Load<std::complex<double>>("complex", options).data, data);
+	ASSERT_EQ(archive.Load<float>("floats", options).shape, std::vector<size_t>({ 2, 3 }));
+	ASSERT_EQ(archive.Load<float>("floats", options).data, floats);
+	ASSERT_TRUE(archive.Info("integers").IsStored());
+	ASSERT_EQ(archive.Load<int64_t>("integers", options).data, integers);
+	for (size_t i = 0; i < 100; ++i)
+		ASSERT_EQ(archive.Load<uint8_t>("member" + std::to_string(i), options).data, std::vector<uint8_t>(i, static_cast<uint8_t>(i)));
+}
+
+TEST_F(NpzTests, StreamingWriter)
+{
+	// one z-slice at a time
+	const size_t sliceSize = Ny * Nx;
+	npypp::CompressionOptions stored;
+	stored.method = npypp::CompressionMethod::Stored;
+	{
+		npypp::NpzWriter writer("out.npz");
+		writer.BeginMember<std::complex<double>>("deflated", shape);
+		for (size_t k = 0; k < Nz; ++k)
+			writer.Write(data.data() + k * sliceSize, sliceSize);
+		writer.EndMember();
+
+		writer.BeginMember<std::complex<double>>("stored", shape, stored);
+		for (size_t k = 0; k < Nz; ++k)
+			writer.Write(std::vector<std::complex<double>>(data.begin() + static_cast<std::ptrdiff_t>(k * sliceSize), data.begin() + static_cast<std::ptrdiff_t>((k + 1) * sliceSize)));
+		writer.EndMember();
+
+		writer.Write("floats", std::vector<float> { 1.0f, 2.0f }, { 2 });
+
+		// ended by Close()
+		writer.BeginMember<int>("unfinished", { 3 });
+		writer.Write(std::vector<int> { 1, 2, 3 });
+	}
+
+	npypp::NpzArchive archive("out.npz");
+	ASSERT_EQ(archive.Names(), std::vector<std::string>({ "deflated", "stored", "floats", "unfinished" }));
+	ASSERT_TRUE(archive.Info("stored").IsStored());
+	ASSERT_FALSE(archive.Info("deflated").IsStored());
+	npypp::NpzLoadOptions options;
+	options.verifyCrc = true;
+	ASSERT_EQ(archive.Load<std::complex<double>>("deflated", options).data, data);
+	ASSERT_EQ(archive.Load<std::complex<double>>("stored", options).data, data);
+	ASSERT_EQ(archive.Load<std::complex<double>>("stored", options).shape, shape);
+	ASSERT_EQ(archive.Load<float>("floats", options).data, std::vector<float>({ 1.0f, 2.0f }));
+	ASSERT_EQ(archive.Load<int>("unfinished", options).data, std::vector<int>({ 1, 2, 3 }));
+
+	npypp::NpzWriter writer("out.npz");
+	writer.BeginMember<int>("short", { 3 });
+	writer.Write(std::vector<int> { 1, 2 });
+	ASSERT_THROW(writer.EndMember(), std::runtime_error);
+	writer.Write("floats", std::vector<float> { 1.0f, 2.0f }, { 2 });
+	writer.Close();
+	ASSERT_EQ(npypp::NpzArchive("out.npz").Names(), std::vector<std::string>({ "floats" }));
+	ASSERT_EQ(npypp::NpzArchive("out.npz").GetUnreferencedBytes(), 0);
+
+	// a short member left open is dropped on Close, which still writes the central directory, keeping the members already there
+	{
+		npypp::NpzWriter appender("out.npz", "a");
+		appender.BeginMember<std::complex<double>>("abandoned", shape);
+		appender.Write(data.data(), TotalSize / 2);
+		ASSERT_THROW(appender.Close(), std::runtime_error);
+		ASSERT_FALSE(appender.IsOpen());
+	}
+	ASSERT_EQ(npypp::NpzArchive("out.npz").Names(), std::vector<std::string>({ "floats" }));
+	ASSERT_EQ(npypp::NpzArchive("out.npz").Load<float>("floats", options).data, std::vector<float>({ 1.0f, 2.0f }));
+	ASSERT_EQ(npypp::NpzArchive("out.npz").GetUnreferencedBytes(), 0);
+
+	// same from the destructor, which can't report it
+	{
+		npypp::NpzWriter appender("out.npz", "a");
+		appender.BeginMember<int>("abandoned", { 3 });
+		appender.Write(std::vector<int> { 1 });
+	}
+	ASSERT_EQ(npypp::NpzArchive("out.npz").Names(), std::vector<std::string>({ "floats" }));
+}
+
+TEST_F(NpzTests, ReplaceRemoveCompact)
+{
+	const std::vector<float> floats { 1.0f, 2.0f, 3.0f };
+	{
+		npypp::NpzWriter writer("out.npz");
+		writer.Write("arr1", data, shape);
+		writer.Write("arr2", data, shape);
+		writer.Write("arr3", floats, { floats.size() });
+	}
+	// duplicate, as written by appending
+	npypp::SaveCompressed("out.npz", "arr2", floats, { floats.size() }, "a");
+
+	npypp::NpzArchive archive("out.npz");
+	ASSERT_EQ(archive.size(), 4);
+	ASSERT_EQ(archive.GetUnreferencedBytes(), 0);
+
+	const std::vector<int32_t> integers { 1, 2, 3, 4 };
+	archive.Replace("arr2", integers, { 2, 2 });
+	archive.Replace("arr4", floats, { floats.size() });
+	// the new arr2 takes the place of the duplicate that shadowed the first one
+	ASSERT_EQ(archive.Names(), std::vector<std::string>({ "arr1", "arr3", "arr2", "arr4" }));
+	ASSERT_GT(archive.GetUnreferencedBytes(), 0);
+
+	ASSERT_TRUE(archive.Remove("arr1"));
+	ASSERT_FALSE(archive.Remove("arr1"));
+	ASSERT_EQ(archive.Names(), std::vector<std::string>({ "arr3", "arr2", "arr4" }));
+
+	const auto check = [&](npypp::NpzArchive& npz)
+	{
+		npypp::NpzLoadOptions options;
+		options.verifyCrc = true;
+		ASSERT_EQ(npz.Names(), std::vector<std::string>({ "arr3", "arr2", "arr4" }));
+		ASSERT_EQ(npz.Load<int32_t>("arr2", options).data, integers);
+		ASSERT_EQ(npz.Load<int32_t>("arr2", options).shape, std::vector<size_t>({ 2, 2 }));
+		ASSERT_EQ(npz.Load<float>("arr3", options).data, floats);
+		ASSERT_EQ(npz.Load<float>("arr4", options).data, floats);
+	};
+	check(archive);
+	npypp::NpzArchive reopened("out.npz");
+	check(reopened);
+
+	const size_t sizeBeforeCompaction = FileSize("out.npz");
+	const uint64_t unreferencedBytes = archive.GetUnreferencedBytes();
+	archive.Compact();
+	ASSERT_EQ(FileSize("out.npz"), sizeBeforeCompaction - unreferencedBytes);
+	ASSERT_EQ(archive.GetUnreferencedBytes(), 0);
+	check(archive);
+	npypp::NpzArchive compacted("out.npz");
+	check(compacted);
+}